@@ -0,0 +1,124 @@
+/**
+ * Failure budget: a suite stops after the given number of failures, in
+ * serial and parallel runs, and the tests it did not run are counted as
+ * cancelled. m_main() spreads the budget over all its suites.
+ */
+#include <stdlib.h>
+#include <unistd.h>
+#include <mamma.h>
+
+static void budget_fail(struct m_test *m_test)
+{
+	m_assert_int_eq(0, 1);
+}
+
+static void budget_crash(struct m_test *m_test)
+{
+	*(volatile int *)NULL = 1;
+}
+
+static void budget_good(struct m_test *m_test)
+{
+	usleep(10000);
+}
+
+static struct m_test budget_tests[] = {
+	m_test(NULL, budget_good, NULL),
+	m_test(NULL, budget_fail, NULL),
+	m_test(NULL, budget_good, NULL),
+	m_test(NULL, budget_fail, NULL),
+	m_test(NULL, budget_good, NULL),
+	m_test(NULL, budget_good, NULL),
+	m_test(NULL, budget_good, NULL),
+};
+static struct m_test budget_crash_tests[] = {
+	m_test(NULL, budget_crash, NULL),
+	m_test(NULL, budget_crash, NULL),
+	m_test(NULL, budget_crash, NULL),
+	m_test(NULL, budget_good, NULL),
+	m_test(NULL, budget_good, NULL),
+	m_test(NULL, budget_good, NULL),
+};
+static struct m_suite budget_suite = m_suite("budget", 0, budget_tests,
+					     NULL, NULL);
+static struct m_suite budget_crash_suite = m_suite("budget crash", 0,
+						   budget_crash_tests,
+						   NULL, NULL);
+
+
+static void test_budget_fail_fast(struct m_test *m_test)
+{
+	budget_suite.flags = M_FAIL_FAST;
+	budget_suite.fail_budget = 0;
+	m_suite_run(&budget_suite);
+
+	m_assert_int_eq(2, budget_suite.total_count);
+	m_assert_int_eq(1, budget_suite.success_count);
+	m_assert_int_eq(1, budget_suite.fail_count);
+	m_assert_int_eq(5, budget_suite.cancelled_count);
+	m_assert_int_eq(M_STATE_EXIT_NORUN, budget_tests[2].exit);
+}
+static const char *test_budget_fail_fast_desc = "It stops a serial run at the first failure";
+
+static void test_budget_serial(struct m_test *m_test)
+{
+	budget_suite.flags = 0;
+	budget_suite.fail_budget = 2;
+	m_suite_run(&budget_suite);
+
+	m_assert_int_eq(4, budget_suite.total_count);
+	m_assert_int_eq(2, budget_suite.fail_count);
+	m_assert_int_eq(3, budget_suite.cancelled_count);
+}
+static const char *test_budget_serial_desc = "It stops a serial run after the given number of failures";
+
+static void test_budget_parallel(struct m_test *m_test)
+{
+	budget_crash_suite.fail_budget = 1;
+	m_suite_run_parallel(&budget_crash_suite, 2);
+
+	/* The other worker may fail as well before it gets cancelled */
+	m_assert_int_range(1, 2, budget_crash_suite.fail_count);
+	m_assert_int_eq(6, budget_crash_suite.total_count +
+			   budget_crash_suite.cancelled_count);
+	m_assert_int_ge(budget_crash_suite.cancelled_count, 3);
+}
+static const char *test_budget_parallel_desc = "It counts the crashed workers as failures and it cancels the others";
+
+static void test_budget_main(struct m_test *m_test)
+{
+	struct m_suite *suites[] = {&budget_suite, &budget_crash_suite};
+	char *args[] = {"budget", "--max-failures=1", NULL};
+
+	budget_suite.fail_budget = 0;
+	budget_crash_suite.fail_budget = 0;
+	m_assert_int_eq(EXIT_FAILURE, m_main(2, args, suites, 2));
+	m_assert_int_eq(1, budget_suite.fail_count);
+	m_assert_int_eq(5, budget_suite.cancelled_count);
+}
+static const char *test_budget_main_desc = "It spreads the budget of m_main() over its suites";
+
+
+int main(int argc, char *argv[])
+{
+	struct m_test tests[] = {
+		m_test_desc(NULL, test_budget_fail_fast, NULL,
+			    test_budget_fail_fast_desc),
+		m_test_desc(NULL, test_budget_serial, NULL,
+			    test_budget_serial_desc),
+		m_test_desc(NULL, test_budget_parallel, NULL,
+			    test_budget_parallel_desc),
+		m_test_desc(NULL, test_budget_main, NULL,
+			    test_budget_main_desc),
+	};
+	struct m_suite suite = {
+		.name = "Mamma failure budget",
+		.flags = M_VERBOSE,
+		.tests = tests,
+		.test_count = M_ARRAY_SIZE(tests),
+	};
+
+	m_suite_run(&suite);
+
+	return suite.fail_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
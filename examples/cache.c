@@ -0,0 +1,130 @@
+/**
+ * Results cache: tests that succeeded with the same code are replayed as
+ * cached successes without running, failed tests run again, and
+ * M_CACHE_FORCE (m_main() --force) runs everything.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <mamma.h>
+
+static unsigned int cache_runs, cache_broken = 1;
+static char cache_path[] = "/tmp/mamma-cache-XXXXXX";
+
+static void cache_good(struct m_test *m_test)
+{
+	cache_runs++;
+}
+
+static void cache_flaky(struct m_test *m_test)
+{
+	cache_runs++;
+	m_assert_int_eq(0, cache_broken);
+}
+
+static struct m_test cache_tests[] = {
+	m_test_desc(NULL, cache_good, NULL, "first"),
+	m_test_desc(NULL, cache_flaky, NULL, "flaky"),
+	m_test_desc(NULL, cache_good, NULL, "third"),
+};
+static struct m_suite cache_suite = m_suite("cache", 0, cache_tests,
+					    NULL, NULL);
+
+
+static void test_cache_replay(struct m_test *m_test)
+{
+	cache_suite.cache = cache_path;
+
+	/* Empty cache, everything runs */
+	cache_runs = 0;
+	m_suite_run(&cache_suite);
+	m_assert_int_eq(3, cache_runs);
+	m_assert_int_eq(2, cache_suite.success_count);
+	m_assert_int_eq(1, cache_suite.fail_count);
+	m_assert_int_eq(0, cache_suite.cached_count);
+
+	/* Successes are replayed, the failure runs again */
+	cache_runs = 0;
+	m_suite_run(&cache_suite);
+	m_assert_int_eq(1, cache_runs);
+	m_assert_int_eq(3, cache_suite.total_count);
+	m_assert_int_eq(2, cache_suite.cached_count);
+	m_assert_int_eq(1, cache_suite.fail_count);
+	m_assert_int_eq(M_STATE_EXIT_CACHED, cache_tests[0].exit);
+	m_assert_int_eq(M_STATE_EXIT_ERROR, cache_tests[1].exit);
+
+	/* Once fixed, it joins the others */
+	cache_broken = 0;
+	cache_runs = 0;
+	m_suite_run(&cache_suite);
+	m_assert_int_eq(1, cache_runs);
+	m_assert_int_eq(1, cache_suite.success_count);
+
+	cache_runs = 0;
+	m_suite_run(&cache_suite);
+	m_assert_int_eq(0, cache_runs);
+	m_assert_int_eq(3, cache_suite.cached_count);
+}
+static const char *test_cache_replay_desc = "It replays the successes and it runs the failures again";
+
+static void test_cache_force(struct m_test *m_test)
+{
+	cache_runs = 0;
+	cache_suite.flags |= M_CACHE_FORCE;
+	m_suite_run(&cache_suite);
+	cache_suite.flags &= ~M_CACHE_FORCE;
+
+	m_assert_int_eq(3, cache_runs);
+	m_assert_int_eq(0, cache_suite.cached_count);
+	m_assert_int_eq(3, cache_suite.success_count);
+}
+static const char *test_cache_force_desc = "It runs the cached tests with M_CACHE_FORCE";
+
+static void test_cache_main(struct m_test *m_test)
+{
+	struct m_suite *suites[] = {&cache_suite};
+	char opt[64], *args[] = {"cache", opt, "--force", NULL};
+
+	cache_suite.cache = NULL;
+	snprintf(opt, sizeof(opt), "--cache=%s", cache_path);
+
+	cache_runs = 0;
+	m_assert_int_eq(EXIT_SUCCESS, m_main(2, args, suites, 1));
+	m_assert_int_eq(0, cache_runs);
+	m_assert_int_eq(3, cache_suite.cached_count);
+
+	/* A fully cached suite runs again when forced */
+	m_assert_int_eq(EXIT_SUCCESS, m_main(3, args, suites, 1));
+	m_assert_int_eq(3, cache_runs);
+	m_assert_int_eq(3, cache_suite.success_count);
+}
+static const char *test_cache_main_desc = "It uses the cache of m_main() --cache and --force";
+
+
+int main(int argc, char *argv[])
+{
+	struct m_test tests[] = {
+		m_test_desc(NULL, test_cache_replay, NULL,
+			    test_cache_replay_desc),
+		m_test_desc(NULL, test_cache_force, NULL,
+			    test_cache_force_desc),
+		m_test_desc(NULL, test_cache_main, NULL, test_cache_main_desc),
+	};
+	struct m_suite suite = {
+		.name = "Mamma results cache",
+		.flags = M_VERBOSE,
+		.tests = tests,
+		.test_count = M_ARRAY_SIZE(tests),
+	};
+	int fd;
+
+	fd = mkstemp(cache_path);
+	if (fd < 0)
+		return EXIT_FAILURE;
+	close(fd);
+
+	m_suite_run(&suite);
+
+	unlink(cache_path);
+	return suite.fail_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,89 @@
+/**
+ * Crash recovery: faults raised by a test set_up() or test() become test
+ * errors, and the rest of the suite runs. Serial runs recover in the
+ * process, pool workers die with their test and they are replaced.
+ */
+#include <stdlib.h>
+#include <mamma.h>
+
+static unsigned int crash_tear_downs;
+
+static void crash_segv(struct m_test *m_test)
+{
+	*(volatile int *)NULL = 1;
+}
+
+static void crash_abort(struct m_test *m_test)
+{
+	abort();
+}
+
+static void crash_good(struct m_test *m_test)
+{
+}
+
+static void crash_tear_down(struct m_test *m_test)
+{
+	crash_tear_downs++;
+}
+
+static struct m_test crash_tests[] = {
+	m_test(NULL, crash_segv, crash_tear_down),
+	m_test(NULL, crash_good, crash_tear_down),
+	m_test(NULL, crash_abort, crash_tear_down),
+	m_test(crash_segv, crash_good, crash_tear_down),
+	m_test(NULL, crash_good, crash_tear_down),
+};
+static struct m_suite crash_suite = m_suite("crash", 0, crash_tests,
+					    NULL, NULL);
+
+
+static void test_crash_serial(struct m_test *m_test)
+{
+	crash_tear_downs = 0;
+	m_suite_run(&crash_suite);
+
+	m_assert_int_eq(5, crash_suite.total_count);
+	m_assert_int_eq(2, crash_suite.success_count);
+	m_assert_int_eq(3, crash_suite.fail_count);
+	m_assert_int_eq(M_STATE_EXIT_ERROR, crash_tests[0].exit);
+	m_assert_int_eq(M_STATE_EXIT_ERROR, crash_tests[2].exit);
+	m_assert_int_eq(M_STATE_EXIT_ERROR, crash_tests[3].exit);
+	m_assert_int_eq(M_STATE_EXIT_SUCCESS, crash_tests[4].exit);
+	/* tear_down() runs also after a crash */
+	m_assert_int_eq(5, crash_tear_downs);
+}
+static const char *test_crash_serial_desc = "It recovers from SIGSEGV and SIGABRT in test() and set_up()";
+
+static void test_crash_parallel(struct m_test *m_test)
+{
+	m_suite_run_parallel(&crash_suite, 2);
+
+	m_assert_int_eq(5, crash_suite.total_count);
+	m_assert_int_eq(2, crash_suite.success_count);
+	m_assert_int_eq(3, crash_suite.fail_count);
+	m_assert_int_eq(M_STATE_EXIT_ERROR, crash_tests[0].exit);
+	m_assert_int_eq(M_STATE_EXIT_SUCCESS, crash_tests[1].exit);
+}
+static const char *test_crash_parallel_desc = "It replaces the workers killed by a crash";
+
+
+int main(int argc, char *argv[])
+{
+	struct m_test tests[] = {
+		m_test_desc(NULL, test_crash_serial, NULL,
+			    test_crash_serial_desc),
+		m_test_desc(NULL, test_crash_parallel, NULL,
+			    test_crash_parallel_desc),
+	};
+	struct m_suite suite = {
+		.name = "Mamma crash recovery",
+		.flags = M_VERBOSE,
+		.tests = tests,
+		.test_count = M_ARRAY_SIZE(tests),
+	};
+
+	m_suite_run(&suite);
+
+	return suite.fail_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
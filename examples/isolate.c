@@ -0,0 +1,119 @@
+/**
+ * Crash isolation (M_ISOLATE): the suite set_up() runs once, tests run
+ * in children forked from it, and a crash takes down only its child. It
+ * is reported as an error. Children are replaced after each test, or
+ * every m_suite->isolate_batch tests.
+ */
+#include <stdlib.h>
+#include <mamma.h>
+
+static unsigned int isolate_set_ups, isolate_tear_downs;
+static unsigned int isolate_dirty;
+
+static void isolate_set_up(struct m_suite *m_suite)
+{
+	isolate_set_ups++;
+}
+
+static void isolate_tear_down(struct m_suite *m_suite)
+{
+	isolate_tear_downs++;
+}
+
+static void isolate_segv(struct m_test *m_test)
+{
+	*(volatile int *)NULL = 1;
+}
+
+static void isolate_abort(struct m_test *m_test)
+{
+	abort();
+}
+
+/* A fresh child sees the state left by set_up() */
+static void isolate_clean(struct m_test *m_test)
+{
+	m_assert_int_eq(0, isolate_dirty);
+	isolate_dirty = 1;
+}
+
+static struct m_test isolate_tests[] = {
+	m_test(NULL, isolate_clean, NULL),
+	m_test(NULL, isolate_segv, NULL),
+	m_test(NULL, isolate_clean, NULL),
+	m_test(NULL, isolate_abort, NULL),
+	m_test(NULL, isolate_clean, NULL),
+};
+static struct m_suite isolate_suite = m_suite("isolate", M_ISOLATE,
+					      isolate_tests,
+					      isolate_set_up,
+					      isolate_tear_down);
+
+
+static void test_isolate_batch(struct m_test *m_test)
+{
+	isolate_set_ups = 0;
+	isolate_tear_downs = 0;
+	m_suite_run(&isolate_suite);
+
+	m_assert_int_eq(1, isolate_set_ups);
+	m_assert_int_eq(1, isolate_tear_downs);
+	m_assert_int_eq(0, isolate_dirty);
+	m_assert_int_eq(5, isolate_suite.total_count);
+	m_assert_int_eq(3, isolate_suite.success_count);
+	m_assert_int_eq(2, isolate_suite.fail_count);
+	m_assert_int_eq(M_STATE_EXIT_ERROR, isolate_tests[1].exit);
+	m_assert_int_eq(M_STATE_EXIT_SUCCESS, isolate_tests[2].exit);
+	m_assert_int_eq(M_STATE_EXIT_ERROR, isolate_tests[3].exit);
+}
+static const char *test_isolate_batch_desc = "It runs each test in a fresh child forked after set_up()";
+
+static void test_isolate_no_batch(struct m_test *m_test)
+{
+	isolate_suite.isolate_batch = M_ISOLATE_BATCH_ALL;
+	m_suite_run(&isolate_suite);
+
+	/* A child runs tests until one of them crashes it */
+	m_assert_int_eq(5, isolate_suite.total_count);
+	m_assert_int_eq(2, isolate_suite.fail_count);
+	m_assert_int_eq(M_STATE_EXIT_SUCCESS, isolate_tests[0].exit);
+	m_assert_int_eq(M_STATE_EXIT_SUCCESS, isolate_tests[2].exit);
+	m_assert_int_eq(M_STATE_EXIT_SUCCESS, isolate_tests[4].exit);
+}
+static const char *test_isolate_no_batch_desc = "It replaces a child only when a test crashes it";
+
+static void test_isolate_parallel(struct m_test *m_test)
+{
+	isolate_set_ups = 0;
+	isolate_suite.isolate_batch = 0;
+	m_suite_run_parallel(&isolate_suite, 2);
+
+	m_assert_int_eq(1, isolate_set_ups);
+	m_assert_int_eq(0, isolate_dirty);
+	m_assert_int_eq(3, isolate_suite.success_count);
+	m_assert_int_eq(2, isolate_suite.fail_count);
+}
+static const char *test_isolate_parallel_desc = "It isolates the tests of the pool workers the same way";
+
+
+int main(int argc, char *argv[])
+{
+	struct m_test tests[] = {
+		m_test_desc(NULL, test_isolate_batch, NULL,
+			    test_isolate_batch_desc),
+		m_test_desc(NULL, test_isolate_no_batch, NULL,
+			    test_isolate_no_batch_desc),
+		m_test_desc(NULL, test_isolate_parallel, NULL,
+			    test_isolate_parallel_desc),
+	};
+	struct m_suite suite = {
+		.name = "Mamma crash isolation",
+		.flags = M_VERBOSE,
+		.tests = tests,
+		.test_count = M_ARRAY_SIZE(tests),
+	};
+
+	m_suite_run(&suite);
+
+	return suite.fail_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
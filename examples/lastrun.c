@@ -0,0 +1,119 @@
+/**
+ * Failed-first ordering: with m_suite->last_run, the tests that failed in
+ * the last run come first, then the new ones, then all the others. With
+ * M_FAIL_FAST a test that still fails stops the suite right away.
+ */
+#include <stdlib.h>
+#include <unistd.h>
+#include <mamma.h>
+
+static unsigned int lastrun_order[16];
+static unsigned int lastrun_count, lastrun_broken = 1;
+static char lastrun_path[] = "/tmp/mamma-lastrun-XXXXXX";
+
+static void lastrun_good(struct m_test *m_test);
+static void lastrun_bad(struct m_test *m_test);
+
+static struct m_test lastrun_tests[] = {
+	m_test_desc(NULL, lastrun_good, NULL, "zero"),
+	m_test_desc(NULL, lastrun_good, NULL, "one"),
+	m_test_desc(NULL, lastrun_good, NULL, "two"),
+	m_test_desc(NULL, lastrun_bad, NULL, "three"),
+	m_test_desc(NULL, lastrun_good, NULL, "four"),
+};
+
+static void lastrun_good(struct m_test *m_test)
+{
+	lastrun_order[lastrun_count++] = m_test - lastrun_tests;
+}
+
+static void lastrun_bad(struct m_test *m_test)
+{
+	lastrun_order[lastrun_count++] = m_test - lastrun_tests;
+	m_assert_int_eq(0, lastrun_broken);
+}
+
+static struct m_suite lastrun_suite = m_suite("lastrun", 0, lastrun_tests,
+					      NULL, NULL);
+
+
+static void test_lastrun_order(struct m_test *m_test)
+{
+	lastrun_suite.last_run = lastrun_path;
+
+	/* Test "one" is new in the next run */
+	lastrun_tests[1].flags |= M_TEST_DISABLED;
+	lastrun_count = 0;
+	m_suite_run(&lastrun_suite);
+	lastrun_tests[1].flags &= ~M_TEST_DISABLED;
+	m_assert_int_eq(4, lastrun_count);
+	m_assert_int_eq(1, lastrun_suite.fail_count);
+
+	lastrun_count = 0;
+	m_suite_run(&lastrun_suite);
+	m_assert_int_eq(5, lastrun_count);
+	m_assert_int_eq(3, lastrun_order[0]);
+	m_assert_int_eq(1, lastrun_order[1]);
+	m_assert_int_eq(0, lastrun_order[2]);
+	m_assert_int_eq(2, lastrun_order[3]);
+	m_assert_int_eq(4, lastrun_order[4]);
+}
+static const char *test_lastrun_order_desc = "It runs the last failures first, then the new tests";
+
+static void test_lastrun_fail_fast(struct m_test *m_test)
+{
+	lastrun_count = 0;
+	lastrun_suite.flags |= M_FAIL_FAST;
+	m_suite_run(&lastrun_suite);
+	lastrun_suite.flags &= ~M_FAIL_FAST;
+
+	m_assert_int_eq(1, lastrun_count);
+	m_assert_int_eq(1, lastrun_suite.total_count);
+	m_assert_int_eq(1, lastrun_suite.fail_count);
+}
+static const char *test_lastrun_fail_fast_desc = "It stops at the first test when it still fails";
+
+static void test_lastrun_fixed(struct m_test *m_test)
+{
+	lastrun_broken = 0;
+	m_suite_run(&lastrun_suite);
+
+	/* Nothing failed last time, the index order is back */
+	lastrun_count = 0;
+	m_suite_run(&lastrun_suite);
+	m_assert_int_eq(5, lastrun_count);
+	m_assert_int_eq(5, lastrun_suite.success_count);
+	m_assert_int_eq(0, lastrun_order[0]);
+	m_assert_int_eq(3, lastrun_order[3]);
+}
+static const char *test_lastrun_fixed_desc = "It goes back to the index order once the failure is fixed";
+
+
+int main(int argc, char *argv[])
+{
+	struct m_test tests[] = {
+		m_test_desc(NULL, test_lastrun_order, NULL,
+			    test_lastrun_order_desc),
+		m_test_desc(NULL, test_lastrun_fail_fast, NULL,
+			    test_lastrun_fail_fast_desc),
+		m_test_desc(NULL, test_lastrun_fixed, NULL,
+			    test_lastrun_fixed_desc),
+	};
+	struct m_suite suite = {
+		.name = "Mamma failed-first ordering",
+		.flags = M_VERBOSE,
+		.tests = tests,
+		.test_count = M_ARRAY_SIZE(tests),
+	};
+	int fd;
+
+	fd = mkstemp(lastrun_path);
+	if (fd < 0)
+		return EXIT_FAILURE;
+	close(fd);
+
+	m_suite_run(&suite);
+
+	unlink(lastrun_path);
+	return suite.fail_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,193 @@
+/**
+ * Command line driver: m_main() selects the tests by suite name and test
+ * description, it lists them, it repeats them and it splits them in
+ * shards. Its exit status tells if the selected tests succeeded.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <mamma.h>
+
+static void main_good(struct m_test *m_test);
+static void main_fail(struct m_test *m_test);
+
+static struct m_test main_net_tests[] = {
+	m_test_desc(NULL, main_good, NULL, "connect"),
+	m_test_desc(NULL, main_good, NULL, "send"),
+	m_test_desc(NULL, main_fail, NULL, "recv timeout"),
+	m_test_desc(NULL, main_good, NULL, "close"),
+};
+static struct m_test main_math_tests[] = {
+	m_test_desc(NULL, main_good, NULL, "sum"),
+	m_test_desc(NULL, main_good, NULL, "product"),
+	m_test_desc(NULL, main_good, NULL, "division"),
+};
+static struct m_suite main_net = m_suite("net", 0, main_net_tests,
+					 NULL, NULL);
+static struct m_suite main_math = m_suite("math", 0, main_math_tests,
+					  NULL, NULL);
+static struct m_suite *main_suites[] = {&main_net, &main_math};
+
+/* Runs of each test: net tests first, then math ones */
+static unsigned int main_runs[M_ARRAY_SIZE(main_net_tests) +
+			      M_ARRAY_SIZE(main_math_tests)];
+
+static void main_count(struct m_test *m_test)
+{
+	if (m_test >= main_net_tests &&
+	    m_test < main_net_tests + M_ARRAY_SIZE(main_net_tests))
+		main_runs[m_test - main_net_tests]++;
+	else
+		main_runs[M_ARRAY_SIZE(main_net_tests) +
+			  (m_test - main_math_tests)]++;
+}
+
+static void main_good(struct m_test *m_test)
+{
+	main_count(m_test);
+}
+
+static void main_fail(struct m_test *m_test)
+{
+	main_count(m_test);
+	m_assert_int_eq(0, 1);
+}
+
+/* It runs m_main() with up to two options */
+static int main_run(char *opt1, char *opt2)
+{
+	char *args[] = {"main", opt1, opt2, NULL};
+	unsigned int i;
+
+	for (i = 0; i < M_ARRAY_SIZE(main_runs); ++i)
+		main_runs[i] = 0;
+
+	return m_main(1 + !!opt1 + !!opt2, args, main_suites,
+		      M_ARRAY_SIZE(main_suites));
+}
+
+
+static void test_main_all(struct m_test *m_test)
+{
+	unsigned int i;
+
+	m_assert_int_eq(EXIT_FAILURE, main_run(NULL, NULL));
+	for (i = 0; i < M_ARRAY_SIZE(main_runs); ++i)
+		m_assert_int_eq(1, main_runs[i]);
+}
+static const char *test_main_all_desc = "It runs all the tests, and it fails when one of them fails";
+
+static void test_main_filter(struct m_test *m_test)
+{
+	m_assert_int_eq(EXIT_SUCCESS, main_run("--suite=ma*", NULL));
+	m_assert_int_eq(0, main_runs[0]);
+	m_assert_int_eq(3, main_math.total_count);
+
+	/* "send", "product" and "division" */
+	m_assert_int_eq(EXIT_SUCCESS, main_run("-t", "*d*"));
+	m_assert_int_eq(0, main_runs[0] + main_runs[2] + main_runs[3] +
+			   main_runs[4]);
+	m_assert_int_eq(3, main_runs[1] + main_runs[5] + main_runs[6]);
+
+	m_assert_int_eq(EXIT_FAILURE, main_run("-E", "--test=^(send|recv)"));
+	m_assert_int_eq(2, main_net.total_count);
+	m_assert_int_eq(1, main_net.fail_count);
+}
+static const char *test_main_filter_desc = "It selects the tests by suite name and test description";
+
+static void test_main_list(struct m_test *m_test)
+{
+	unsigned int i;
+
+	m_assert_int_eq(EXIT_SUCCESS, main_run("--list", NULL));
+	for (i = 0; i < M_ARRAY_SIZE(main_runs); ++i)
+		m_assert_int_eq(0, main_runs[i]);
+}
+static const char *test_main_list_desc = "It lists the tests without running them";
+
+static void test_main_repeat(struct m_test *m_test)
+{
+	m_assert_int_eq(EXIT_SUCCESS, main_run("--repeat=3", "--suite=math"));
+	m_assert_int_eq(3, main_runs[4]);
+	m_assert_int_eq(3, main_runs[5]);
+	m_assert_int_eq(3, main_runs[6]);
+}
+static const char *test_main_repeat_desc = "It runs the selected tests more times";
+
+static void test_main_shard(struct m_test *m_test)
+{
+	unsigned int i, shard, seen[M_ARRAY_SIZE(main_runs)] = {0};
+	char opt[32];
+
+	for (shard = 0; shard < 3; ++shard) {
+		snprintf(opt, sizeof(opt), "--shard=%u/3", shard);
+		main_run(opt, NULL);
+		for (i = 0; i < M_ARRAY_SIZE(main_runs); ++i)
+			seen[i] += main_runs[i];
+	}
+	for (i = 0; i < M_ARRAY_SIZE(main_runs); ++i)
+		m_assert_int_eq(1, seen[i]);
+
+	m_assert_int_eq(EXIT_FAILURE, main_run("--shard=3/3", NULL));
+}
+static const char *test_main_shard_desc = "It runs each test in exactly one shard";
+
+static void test_main_restore(struct m_test *m_test)
+{
+	unsigned int i;
+
+	m_assert_int_eq(EXIT_SUCCESS, main_run("--suite=math", "-v"));
+	m_assert_int_eq(0, main_net_tests[0].flags & M_TEST_DISABLED);
+	m_assert_int_eq(0, main_math.flags & M_VERBOSE);
+
+	/* A broader selection after a narrow one runs every test */
+	m_assert_int_eq(EXIT_SUCCESS, main_run("--test=sum", NULL));
+	m_assert_int_eq(EXIT_FAILURE, main_run(NULL, NULL));
+	for (i = 0; i < M_ARRAY_SIZE(main_runs); ++i)
+		m_assert_int_eq(1, main_runs[i]);
+}
+static const char *test_main_restore_desc = "It gives the suites back as they were before the run";
+
+static void test_main_invalid(struct m_test *m_test)
+{
+	unsigned int i;
+
+	m_assert_int_eq(EXIT_FAILURE, main_run("--jobs=abc", NULL));
+	m_assert_int_eq(EXIT_FAILURE, main_run("--jobs=-1", NULL));
+	m_assert_int_eq(EXIT_FAILURE, main_run("--jobs=99999999999", NULL));
+	m_assert_int_eq(EXIT_FAILURE, main_run("--repeat=x", NULL));
+	m_assert_int_eq(EXIT_FAILURE, main_run("--repeat=2x", NULL));
+	m_assert_int_eq(EXIT_FAILURE, main_run("--max-failures=", NULL));
+	m_assert_int_eq(EXIT_FAILURE, main_run("--max-failures", " 1"));
+	for (i = 0; i < M_ARRAY_SIZE(main_runs); ++i)
+		m_assert_int_eq(0, main_runs[i]);
+}
+static const char *test_main_invalid_desc = "It rejects invalid numbers without running the tests";
+
+
+int main(int argc, char *argv[])
+{
+	struct m_test tests[] = {
+		m_test_desc(NULL, test_main_all, NULL, test_main_all_desc),
+		m_test_desc(NULL, test_main_filter, NULL,
+			    test_main_filter_desc),
+		m_test_desc(NULL, test_main_list, NULL, test_main_list_desc),
+		m_test_desc(NULL, test_main_repeat, NULL,
+			    test_main_repeat_desc),
+		m_test_desc(NULL, test_main_shard, NULL,
+			    test_main_shard_desc),
+		m_test_desc(NULL, test_main_restore, NULL,
+			    test_main_restore_desc),
+		m_test_desc(NULL, test_main_invalid, NULL,
+			    test_main_invalid_desc),
+	};
+	struct m_suite suite = {
+		.name = "Mamma command line driver",
+		.flags = M_VERBOSE,
+		.tests = tests,
+		.test_count = M_ARRAY_SIZE(tests),
+	};
+
+	m_suite_run(&suite);
+
+	return suite.fail_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
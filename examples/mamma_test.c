@@ -8,15 +8,37 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include <mamma.h>
 
 
+static const int test_array[] = {
+	-3, -1, 0, 0, 2, 3, 5, 8, 13, 13, 21, 34, 35, 36, 37, 38, 39, 40,
+};
+static const double test_darray[] = {0.5, 1.25, -3.0, 1e9, 0.0};
+static const double test_darray_near[] = {0.5, 1.2500001, -3.0, 1e9 + 1, 0.0};
+static const char test_raw[4] = {'b', 'b', 'b', 'b'}; /* no terminator */
+
 /**
  * It uses all checks
  */
 static void test_good_assert(struct m_test *m_test)
 {
+	const void *test_ptr = test_raw;
+
+	/* Boolean, any scalar: pointers and values beyond 32 bits */
+
+	m_assert_true(test_ptr);
+
+	m_assert_false(NULL);
+
+	m_assert_true(0x100000000LL);
+
+	m_assert_false(0);
+
 	/* Integers */
 
 	m_assert_int_eq(4, 4);
@@ -37,6 +59,40 @@ static void test_good_assert(struct m_test *m_test)
 
 	m_assert_int_nrange(0, 10, 11);
 
+	/* Integers compare as int: wider values are truncated */
+
+	m_assert_int_eq(-1, 0xFFFFFFFFL);
+
+	m_assert_int_lt(0x100000000L, 1);
+
+	m_assert_int_range(-1, 1, 0x100000000L);
+
+	/* Fixed width integers, values that do not fit 32 bits */
+
+	m_assert_i64_neq(0x100000000LL, 0);
+
+	m_assert_i64_lt(-0x100000000LL, 1);
+
+	m_assert_u64_gt(0xFFFFFFFFFFFFFFFFULL, 0x7FFFFFFFFFFFFFFFULL);
+
+	m_assert_u64_range(0x100000000ULL, 0x200000000ULL, 0x180000000ULL);
+
+	m_assert_size_eq((size_t)5 << 32, (size_t)5 << 32);
+
+	m_assert_size_nrange(0, 4096, (size_t)1 << 32);
+
+	/* Arrays */
+
+	m_assert_int_array_eq(test_array, test_array, M_ARRAY_SIZE(test_array));
+
+	m_assert_int_array_all_in_range(-3, 40, test_array,
+					M_ARRAY_SIZE(test_array));
+
+	m_assert_int_array_sorted(test_array, M_ARRAY_SIZE(test_array));
+
+	m_assert_dbl_array_near(test_darray, test_darray_near,
+				M_ARRAY_SIZE(test_darray), 0, 1e-6);
+
 	/* Double */
 
 	m_assert_dbl_eq(4.123456, 4.123456);
@@ -88,6 +144,7 @@ static void test_good_assert(struct m_test *m_test)
 	m_assert_str_null(NULL);
 
 	m_assert_str_eq("bbb", "bbb", 4);
+	m_assert_str_eq(test_raw, "bbbb", sizeof(test_raw));
 
 	m_assert_str_neq("bbb", "aaa", 4);
 
@@ -269,6 +326,72 @@ static void test_bad_real_func(struct m_test *m_test)
 }
 static const char *test_bad_real_func_desc = "It uses a real function that fails but we make the assumption that it does not";
 
+static void test_bench(struct m_test *m_test)
+{
+	char buf[64];
+
+	snprintf(buf, sizeof(buf), "%u", m_test->index);
+	m_assert_str_not_null(buf);
+}
+static const char *test_bench_desc = "It measures a short function";
+
+static void *test_thread_worker(void *arg)
+{
+	m_check_int_eq(0, 1); /* Err, reported only */
+	m_assert_int_eq(0, 1); /* Err, reported only */
+
+	return arg;
+}
+
+static void test_thread(struct m_test *m_test)
+{
+	pthread_t tid;
+
+	m_assert_int_eq(0, pthread_create(&tid, NULL, test_thread_worker,
+					  NULL));
+	m_assert_int_eq(0, pthread_join(tid, NULL));
+}
+static const char *test_thread_desc = "It fails checks in a thread spawned by the test, without a test to stop";
+
+static void test_page_edge(struct m_test *m_test)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	char *mem, *a, *b;
+	size_t len;
+
+	/* Areas end right before an unmapped page: reading past them faults */
+	mem = mmap(NULL, 4 * page, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	m_assert_true(mem != MAP_FAILED);
+	m_assert_int_eq(0, mprotect(mem + page, page, PROT_NONE));
+	m_assert_int_eq(0, mprotect(mem + 3 * page, page, PROT_NONE));
+
+	for (len = 1; len <= 200; ++len) {
+		a = mem + page - len;
+		b = mem + 3 * page - len;
+		memset(a, 'x', len);
+		memset(b, 'x', len);
+		m_assert_mem_eq(a, b, len);
+		b[len - 1] = 'y';
+		m_check_mem_eq(a, b, len); /* Err */
+		b[0] = 'y';
+		m_check_mem_eq(a, b, len); /* Err */
+
+		b[0] = 'x';
+		a[len - 1] = '\0';
+		b[len - 1] = '\0';
+		m_assert_str_eq(a, b, 4096);
+		if (len > 1) {
+			b[len / 2] = 'y';
+			m_assert_str_neq(a, b, 4096);
+			m_assert_str_lt(a, b, 4096);
+		}
+	}
+
+	munmap(mem, 4 * page);
+}
+static const char *test_page_edge_desc = "It compares memory and strings that end right before an unmapped page";
+
 
 int main(int argc, char *argv[])
 {
@@ -285,6 +408,10 @@ int main(int argc, char *argv[])
 			    test_good_real_func_desc),
 		m_test_desc(NULL, test_bad_real_func, NULL,
 			    test_bad_real_func_desc),
+		m_bench(NULL, test_bench, NULL, test_bench_desc, 1000),
+		m_test_desc(NULL, test_thread, NULL, test_thread_desc),
+		m_test_desc(NULL, test_page_edge, NULL,
+			    test_page_edge_desc),
 	};
 	struct m_suite suite = {
 		.name = "Mamma auto-test",
@@ -304,6 +431,23 @@ int main(int argc, char *argv[])
 	assert(M_STATE_EXIT_SUCCESS == tests[0].exit);
 	assert(44 == tests[1].warnings);
 	assert(M_STATE_EXIT_SUCCESS == tests[0].exit);
+	assert(1000 == tests[6].bench.samples);
+	assert(tests[6].bench.min <= tests[6].bench.median);
+	assert(tests[6].bench.median <= tests[6].bench.p99);
+	assert(0 == tests[7].warnings);
+	assert(M_STATE_EXIT_SUCCESS == tests[7].exit);
+	assert(400 == tests[8].warnings);
+	assert(M_STATE_EXIT_SUCCESS == tests[8].exit);
+
+	/* Same suite, but distributed among workers */
+	m_suite_run_parallel(&suite, 4);
+
+	assert(0 == tests[0].warnings);
+	assert(M_STATE_EXIT_SUCCESS == tests[0].exit);
+	assert(44 == tests[1].warnings);
+	assert(M_STATE_EXIT_ERROR == tests[5].exit);
+	assert(1000 == tests[6].bench.samples);
+	assert(8 == suite.success_count && 1 == suite.fail_count);
 
 	return 0;
 }
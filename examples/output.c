@@ -0,0 +1,231 @@
+/**
+ * Test output: the messages of a test are written on stdout, up to
+ * m_suite->output_max bytes and followed by a note about what has been
+ * dropped. The output of parallel tests does not interleave, and it is
+ * not lost when a test kills its worker.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <mamma.h>
+
+#define OUTPUT_CHECKS 1000
+
+/* Each failing check prints an error and a "Continue test" line */
+static void output_noisy(struct m_test *m_test, int exp)
+{
+	unsigned int i;
+
+	for (i = 0; i < OUTPUT_CHECKS; ++i)
+		m_check_int_eq(exp, i + 1);
+}
+
+static void output_first(struct m_test *m_test)
+{
+	output_noisy(m_test, -1);
+}
+
+static void output_quiet(struct m_test *m_test)
+{
+}
+
+static void output_second(struct m_test *m_test)
+{
+	output_noisy(m_test, -2);
+}
+
+static struct m_test output_tests[] = {
+	m_test(NULL, output_first, NULL),
+	m_test(NULL, output_quiet, NULL),
+	m_test(NULL, output_second, NULL),
+};
+static struct m_suite output_suite = m_suite("output", 0, output_tests,
+					     NULL, NULL);
+
+static void output_crash(struct m_test *m_test)
+{
+	m_check_int_eq(-3, 0);
+	printf("output_crash: crash\n");
+	*(volatile int *)NULL = 1;
+}
+
+static void output_exit(struct m_test *m_test)
+{
+	m_check_int_eq(-4, 0);
+	exit(3);
+}
+
+static struct m_test output_crash_tests[] = {
+	m_test(NULL, output_crash, NULL),
+	m_test(NULL, output_exit, NULL),
+};
+static struct m_suite output_crash_suite = m_suite("output crash", 0,
+						   output_crash_tests,
+						   NULL, NULL);
+
+/* It runs a suite with stdout in a file, and it returns the file */
+static FILE *output_run_suite(struct m_suite *m_suite, unsigned int nworkers)
+{
+	FILE *f = tmpfile();
+	int fd;
+
+	if (!f)
+		return NULL;
+	fflush(stdout);
+	fd = dup(STDOUT_FILENO);
+	dup2(fileno(f), STDOUT_FILENO);
+	if (nworkers > 1)
+		m_suite_run_parallel(m_suite, nworkers);
+	else
+		m_suite_run(m_suite);
+	fflush(stdout);
+	dup2(fd, STDOUT_FILENO);
+	close(fd);
+	rewind(f);
+
+	return f;
+}
+
+static FILE *output_run(unsigned int nworkers)
+{
+	return output_run_suite(&output_suite, nworkers);
+}
+
+
+static void test_output_cap(struct m_test *m_test)
+{
+	unsigned int notes = 0;
+	char line[256];
+	size_t size = 0;
+	FILE *f;
+
+	output_suite.output_max = 512;
+	f = output_run(1);
+	m_assert_true(f != NULL);
+	while (fgets(line, sizeof(line), f)) {
+		if (strstr(line, "output truncated"))
+			notes++;
+		else
+			size += strlen(line);
+	}
+	fclose(f);
+
+	m_assert_int_eq(3, output_suite.success_count);
+	m_assert_int_eq(2, notes);
+	/* The cap, plus the new line ahead of each note */
+	m_assert_int_ge(2 * (output_suite.output_max + 1), size);
+}
+static const char *test_output_cap_desc = "It cuts the output of a test at m_suite->output_max";
+
+static void test_output_parallel(struct m_test *m_test)
+{
+	unsigned int first = 0, second = 0, switches = 0, notes = 0;
+	char line[256], cur, prv = 0;
+	FILE *f;
+
+	output_suite.output_max = 1024 * 1024;
+	f = output_run(2);
+	m_assert_true(f != NULL);
+	while (fgets(line, sizeof(line), f)) {
+		cur = 0;
+		if (strstr(line, "Expected <-1>"))
+			cur = 'f', first++;
+		else if (strstr(line, "Expected <-2>"))
+			cur = 's', second++;
+		else if (strstr(line, "output truncated"))
+			notes++;
+		if (cur && prv && cur != prv)
+			switches++;
+		if (cur)
+			prv = cur;
+	}
+	fclose(f);
+
+	m_assert_int_eq(3, output_suite.success_count);
+	m_assert_int_eq(OUTPUT_CHECKS, first);
+	m_assert_int_eq(OUTPUT_CHECKS, second);
+	m_assert_int_eq(1, switches);
+	m_assert_int_eq(0, notes);
+}
+static const char *test_output_parallel_desc = "It writes the output of each parallel test in one piece";
+
+static void test_output_crash(struct m_test *m_test)
+{
+	unsigned int crash = 0, killed = 0, exit = 0, exited = 0;
+	char line[256];
+	FILE *f;
+
+	/* The crash ends the child, the exit() is not recovered either */
+	output_crash_suite.flags = M_ISOLATE;
+	f = output_run_suite(&output_crash_suite, 1);
+	m_assert_true(f != NULL);
+	while (fgets(line, sizeof(line), f)) {
+		if (strstr(line, "Expected <-3>"))
+			crash = !killed;
+		else if (strstr(line, "killed by SIGSEGV"))
+			killed = 1;
+		else if (strstr(line, "Expected <-4>"))
+			exit = !exited;
+		else if (strstr(line, "exited with status 3"))
+			exited = 1;
+	}
+	fclose(f);
+
+	m_assert_int_eq(2, output_crash_suite.fail_count);
+	m_assert_int_eq(1, crash);
+	m_assert_int_eq(1, killed);
+	m_assert_int_eq(1, exit);
+	m_assert_int_eq(1, exited);
+}
+static const char *test_output_crash_desc = "It prints the messages of a test that kills its worker, before the crash report";
+
+static void test_output_order(struct m_test *m_test)
+{
+	unsigned int check = 0, own = 0;
+	char line[256];
+	FILE *f;
+
+	/* Serial runs write through: the messages are in order with printf() */
+	output_crash_tests[1].flags |= M_TEST_DISABLED;
+	output_crash_suite.flags = 0;
+	f = output_run_suite(&output_crash_suite, 1);
+	output_crash_tests[1].flags &= ~M_TEST_DISABLED;
+	m_assert_true(f != NULL);
+	while (fgets(line, sizeof(line), f)) {
+		if (strstr(line, "Expected <-3>"))
+			check = !own;
+		else if (strstr(line, "output_crash: crash"))
+			own = 1;
+	}
+	fclose(f);
+
+	m_assert_int_eq(1, output_crash_suite.fail_count);
+	m_assert_int_eq(1, check);
+	m_assert_int_eq(1, own);
+}
+static const char *test_output_order_desc = "It writes the messages of a serial test as they come";
+
+
+int main(int argc, char *argv[])
+{
+	struct m_test tests[] = {
+		m_test_desc(NULL, test_output_cap, NULL, test_output_cap_desc),
+		m_test_desc(NULL, test_output_parallel, NULL,
+			    test_output_parallel_desc),
+		m_test_desc(NULL, test_output_crash, NULL,
+			    test_output_crash_desc),
+		m_test_desc(NULL, test_output_order, NULL,
+			    test_output_order_desc),
+	};
+	struct m_suite suite = {
+		.name = "Mamma test output",
+		.flags = M_VERBOSE,
+		.tests = tests,
+		.test_count = M_ARRAY_SIZE(tests),
+	};
+
+	m_suite_run(&suite);
+
+	return suite.fail_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
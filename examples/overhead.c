@@ -0,0 +1,53 @@
+/*
+ * It measures the framework overhead: it runs a suite of empty tests
+ * (1M by default, or the number given on the command line) and it
+ * reports the time spent per test.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <mamma.h>
+
+#define OVERHEAD_TESTS 1000000
+
+static void overhead_empty(struct m_test *m_test)
+{
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int i, n = OVERHEAD_TESTS;
+	struct m_suite suite = {
+		.name = "overhead",
+	};
+	struct timespec start, stop;
+	double ns;
+
+	if (argc > 1)
+		n = strtoul(argv[1], NULL, 0);
+	if (!n)
+		return EXIT_FAILURE;
+
+	suite.tests = calloc(n, sizeof(*suite.tests));
+	if (!suite.tests)
+		return EXIT_FAILURE;
+	suite.test_count = n;
+	for (i = 0; i < n; ++i) {
+		suite.tests[i].test = overhead_empty;
+		suite.tests[i].loop = 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	m_suite_run(&suite);
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	ns = (stop.tv_sec - start.tv_sec) * 1e9 +
+	     (stop.tv_nsec - start.tv_nsec);
+	fprintf(stdout, "%u empty tests in %.3f s: %.1f ns per test\n",
+		n, ns / 1e9, ns / n);
+
+	m_suite_release(&suite);
+	free(suite.tests);
+
+	return suite.success_count == n ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,35 @@
+#include <string.h>
+#include <mamma.h>
+
+/*
+ * Tests registered with M_TEST() do not need any array or suite
+ * declaration: m_main_registered() finds them at startup. The same
+ * source builds registered.so, that can be run with mamma-run
+ */
+M_TEST_LIBRARY()
+
+M_TEST(string, length)
+{
+	m_assert_int_eq(5, strlen("mamma"));
+}
+
+M_TEST(string, compare)
+{
+	m_assert_str_eq("mamma", "mamma", 5);
+}
+
+M_TEST(math, sum)
+{
+	m_assert_int_eq(4, 2 + 2);
+}
+
+M_TEST(math, division)
+{
+	m_assert_dbl_eq(0.5, 1.0 / 2);
+}
+
+
+int main(int argc, char *argv[])
+{
+	return m_main_registered(argc, argv);
+}
@@ -41,7 +41,7 @@ int main(int argc, char *argv[])
 	};
 	struct m_suite skel_suite = m_suite("skeleton test", 0, skel_tests,
 					    skel_set_up, skel_tear_down);
-	m_suite_run(&skel_suite);
+	struct m_suite *suites[] = {&skel_suite};
 
-	return 0;
+	return m_main(argc, argv, suites, 1);
 }
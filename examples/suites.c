@@ -0,0 +1,68 @@
+/**
+ * Registered suites: tests registered with M_TEST() under the same suite
+ * name make one suite, even when they come from several source files,
+ * and they keep the source file and line order. The array below stands
+ * for the m_tests section of a program linking two test files, emitted
+ * in the reverse order.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <mamma.h>
+
+#define SUITES_TEST(_suite, _file, _line)				\
+	{ .desc = #_suite "@" _file, .loop = 1,				\
+	  .suite_name = #_suite, .file = _file, .line = _line }
+
+static struct m_test suites_section[] = {
+	SUITES_TEST(net, "b.c", 20),
+	SUITES_TEST(net, "b.c", 10),
+	SUITES_TEST(math, "a.c", 40),
+	SUITES_TEST(net, "a.c", 30),
+	SUITES_TEST(net, "a.c", 20),
+	SUITES_TEST(math, "a.c", 10),
+};
+
+
+static void test_suites_split(struct m_test *m_test)
+{
+	struct m_test *stop = suites_section + M_ARRAY_SIZE(suites_section);
+	struct m_suite suites[2];
+
+	m_assert_int_eq(2, m_registered_suites(suites_section, stop, NULL));
+	memset(suites, 0, sizeof(suites));
+	m_assert_int_eq(2, m_registered_suites(suites_section, stop, suites));
+
+	m_assert_str_eq("math", suites[0].name, 5);
+	m_assert_int_eq(2, suites[0].test_count);
+	m_assert_int_eq(10, suites[0].tests[0].line);
+	m_assert_int_eq(40, suites[0].tests[1].line);
+
+	m_assert_str_eq("net", suites[1].name, 4);
+	m_assert_int_eq(4, suites[1].test_count);
+	m_assert_str_eq("a.c", suites[1].tests[0].file, 4);
+	m_assert_int_eq(20, suites[1].tests[0].line);
+	m_assert_int_eq(30, suites[1].tests[1].line);
+	m_assert_str_eq("b.c", suites[1].tests[2].file, 4);
+	m_assert_int_eq(10, suites[1].tests[2].line);
+	m_assert_int_eq(20, suites[1].tests[3].line);
+}
+static const char *test_suites_split_desc = "It merges a suite spread among two source files";
+
+
+int main(int argc, char *argv[])
+{
+	struct m_test tests[] = {
+		m_test_desc(NULL, test_suites_split, NULL,
+			    test_suites_split_desc),
+	};
+	struct m_suite suite = {
+		.name = "Mamma registered suites",
+		.flags = M_VERBOSE,
+		.tests = tests,
+		.test_count = M_ARRAY_SIZE(tests),
+	};
+
+	m_suite_run(&suite);
+
+	return suite.fail_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+/**
+ * Timeouts: a test (or its set_up()) running longer than its timeout is
+ * stopped, its tear_down() runs and it is counted as timed out. Tests
+ * without their own timeout get the suite one.
+ */
+#include <stdlib.h>
+#include <mamma.h>
+
+static unsigned int timeout_tear_downs;
+
+static void timeout_spin(struct m_test *m_test)
+{
+	volatile unsigned long i;
+
+	for (i = 0; ; ++i)
+		;
+}
+
+static void timeout_quick(struct m_test *m_test)
+{
+}
+
+static void timeout_tear_down(struct m_test *m_test)
+{
+	timeout_tear_downs++;
+}
+
+static struct m_test timeout_tests[] = {
+	m_test_desc_timeout(NULL, timeout_spin, timeout_tear_down,
+			    "spinning test", 50),
+	m_test_desc_timeout(NULL, timeout_quick, timeout_tear_down,
+			    "quick test", 1000),
+	m_test_desc_timeout(timeout_spin, timeout_quick, timeout_tear_down,
+			    "spinning set_up", 50),
+	m_test_desc(NULL, timeout_spin, timeout_tear_down,
+		    "spinning test, suite timeout"),
+};
+static struct m_suite timeout_suite = m_suite("timeout", 0, timeout_tests,
+					      NULL, NULL);
+
+
+static void test_timeout_serial(struct m_test *m_test)
+{
+	timeout_tear_downs = 0;
+	timeout_suite.timeout_ms = 50;
+	m_suite_run(&timeout_suite);
+
+	m_assert_int_eq(4, timeout_suite.total_count);
+	m_assert_int_eq(1, timeout_suite.success_count);
+	m_assert_int_eq(3, timeout_suite.timeout_count);
+	m_assert_int_eq(0, timeout_suite.fail_count);
+	m_assert_int_eq(M_STATE_EXIT_TIMEOUT, timeout_tests[0].exit);
+	m_assert_int_eq(M_STATE_EXIT_SUCCESS, timeout_tests[1].exit);
+	m_assert_int_eq(M_STATE_EXIT_TIMEOUT, timeout_tests[2].exit);
+	m_assert_int_eq(M_STATE_EXIT_TIMEOUT, timeout_tests[3].exit);
+	m_assert_int_eq(4, timeout_tear_downs);
+}
+static const char *test_timeout_serial_desc = "It stops the tests and the set_up() that run too long";
+
+static void test_timeout_parallel(struct m_test *m_test)
+{
+	m_suite_run_parallel(&timeout_suite, 2);
+
+	m_assert_int_eq(1, timeout_suite.success_count);
+	m_assert_int_eq(3, timeout_suite.timeout_count);
+}
+static const char *test_timeout_parallel_desc = "It stops the tests that run too long in the workers";
+
+
+int main(int argc, char *argv[])
+{
+	struct m_test tests[] = {
+		m_test_desc(NULL, test_timeout_serial, NULL,
+			    test_timeout_serial_desc),
+		m_test_desc(NULL, test_timeout_parallel, NULL,
+			    test_timeout_parallel_desc),
+	};
+	struct m_suite suite = {
+		.name = "Mamma timeouts",
+		.flags = M_VERBOSE,
+		.tests = tests,
+		.test_count = M_ARRAY_SIZE(tests),
+	};
+
+	m_suite_run(&suite);
+
+	return suite.fail_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
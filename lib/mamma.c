@@ -1,29 +1,219 @@
 /**
  * Copyright 2015 Federico Vaga <www.federicovaga.com>
  */
+#define _GNU_SOURCE /* dl_iterate_phdr() */
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <inttypes.h>
 #include <string.h>
+#include <time.h>
+#include <sched.h>
 #include <setjmp.h>
 #include <stdarg.h>
 #include <errno.h>
 #include <assert.h>
+#include <ctype.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <getopt.h>
+#include <link.h>
+#include <poll.h>
+#include <regex.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
 #include "mamma.h"
 
+struct m_pool;
 
 /**
- * This structure represent the current status of the state machine.
- * This structure assume that there are no parallelism among tests and
- * test-suites. This means that all tests and test-suites run one after
- * the other. Thanks to this assumption we can keep track of current
- * status globally.
+ * Benchmark samples of a previous run
  */
-static struct m_status {
-	jmp_buf global_jbuf; /**< jump bookmark */
+struct m_baseline {
+	uint64_t desc_key; /**< hash of the test description */
+	unsigned int n; /**< number of samples, 0 if there is no baseline */
+	double *samples; /**< sorted samples */
+};
+
+/**
+ * Group of performance counters opened by a run context
+ */
+struct m_perf_group {
+	int state; /**< 0 not open yet, 1 open, -1 not available */
+	unsigned int n; /**< number of open counters */
+	int fd[_M_PERF_MAX]; /**< counters file descriptors, fd[0] is the leader */
+	enum m_perf_counter id[_M_PERF_MAX]; /**< counter of each descriptor */
+};
+
+
+/**
+ * Output accounting of the running test. Pool workers keep it in the pool
+ * shared mapping, next to their arena, so that the parent can print what
+ * a worker that died in the middle of a test left there
+ */
+struct m_arena {
+	size_t len; /**< bytes kept, in the arena or already on stdout */
+	size_t printed; /**< bytes printed by the running test */
+	size_t dropped; /**< messages that did not fit the cap */
+};
+
+/**
+ * Output of the running test. Messages are printed on an unbuffered
+ * stream that cuts them at the output cap. Serial runs write them through
+ * to stdout, in order with what the test prints by itself. Pool workers
+ * collect them in their arena, which is written out at once when the test
+ * completes so that the output of parallel tests does not interleave
+ */
+struct m_out {
+	FILE *f; /**< test stream, NULL until the first message */
+	struct m_arena *arena; /**< accounting of the running test */
+	struct m_arena local; /**< accounting of serial runs */
+	char *buf; /**< arena of the pool worker, NULL in serial runs */
+	size_t cap; /**< maximum output of a test */
+	int active; /**< a test is running, its messages go here */
+};
+
+/**
+ * This structure represent the status of a suite run (its run context).
+ * Each m_suite_run() call has its own context, and each thread keeps
+ * track of the context it is running. This means that different threads
+ * can run different test-suites at the same time: m_check(), m_skip_test()
+ * and the state-machine callbacks always operate on the calling thread's
+ * context.
+ */
+struct m_status {
+	sigjmp_buf global_jbuf; /**< jump bookmark */
 	enum m_state_machine state_cur; /**< current state-machine state */
 	enum m_state_machine state_prv; /**< previous state-machine state */
 	struct m_suite *m_suite_cur; /**< current test-suite running */
 	struct m_test *m_test_cur; /**< current test running */
-} status;
+	struct m_pool *pool; /**< worker pool, NULL when running serially */
+	unsigned int worker; /**< worker identifier within the pool */
+	unsigned int batch_done; /**< tests run by this worker process */
+	struct m_time phase_start; /**< start time of the running test phase */
+	double *samples; /**< benchmark samples of the running test */
+	struct m_perf_group perf; /**< performance counters */
+	struct m_baseline *baseline; /**< per-test baseline samples */
+	void *sigstack; /**< alternate signal stack, NULL if not ours */
+	stack_t sigstack_prv; /**< alternate signal stack to restore */
+	timer_t timer; /**< test timeout timer */
+	int timer_state; /**< 0 not created yet, 1 created, -1 not available */
+	uint64_t deadline; /**< running test deadline (ns), 0 if none */
+	int timed_out; /**< the running test has been stopped by its timeout */
+	int fault_sig; /**< signal raised by the running test, 0 if none */
+	void *fault_addr; /**< address of the fault raised by the running test */
+	int cancelled; /**< the running test has been cancelled */
+	unsigned int *order; /**< tests run order, NULL for the index order */
+	unsigned char *prio; /**< tests priority (see m_last_run_order()) */
+	unsigned int order_pos; /**< next position in the run order */
+	struct m_out out; /**< output of the running test */
+};
+
+/**
+ * Run context of the calling thread
+ */
+static __thread struct m_status *status;
+
+/**
+ * It increments a suite counter. Counters are updated atomically because
+ * the same suite may be observed by other threads while it runs
+ */
+#define m_count_inc(_counter) \
+	__atomic_add_fetch(&(_counter), 1, __ATOMIC_RELAXED)
+
+
+/**
+ * Test result as published by a pool worker to the parent process
+ */
+struct m_result {
+	enum m_state_machine_test_exit_cause exit; /**< test exit cause */
+	unsigned int warnings; /**< number of failed checks */
+	struct m_time time_set_up; /**< time spent in set_up() */
+	struct m_time time_test; /**< time spent in test() */
+	struct m_time time_tear_down; /**< time spent in tear_down() */
+	struct m_bench_stats bench; /**< benchmark statistics */
+	struct m_perf perf; /**< performance counters */
+};
+
+/**
+ * Per-worker queue of tests. The owner takes tests from the head, idle
+ * workers steal tests from the tail
+ */
+struct m_deque {
+	unsigned int lock; /**< spin lock, shared among processes */
+	unsigned int head; /**< next test for the owner */
+	unsigned int tail; /**< one past the last test in the queue */
+};
+
+/**
+ * Worker pool used by m_suite_run_parallel(). It lives in a shared
+ * anonymous mapping so that the parent and all the workers see the
+ * same memory
+ */
+struct m_pool {
+	unsigned int test_count; /**< number of tests to distribute */
+	unsigned int worker_count; /**< number of workers */
+	unsigned int batch; /**< tests run by a worker before it is replaced,
+			       0 for no limit */
+	unsigned int budget; /**< failures that cancel the run, 0 for none */
+	unsigned int failures; /**< failed tests so far */
+	pid_t *pids; /**< worker process identifiers */
+	int *pidfds; /**< worker process file descriptors, -1 if not available */
+	int *current; /**< test currently run by each worker, -1 if none */
+	struct m_result *results; /**< per-test results */
+	struct m_deque *deques; /**< per-worker test queues */
+	unsigned int *slots; /**< test indexes, partitioned among deques */
+	struct m_arena *arenas; /**< per-worker output accounting */
+	char *output; /**< per-worker output arenas, output_max bytes each */
+	size_t output_max; /**< maximum output of a test */
+	size_t size; /**< mapping size */
+};
+
+
+/**
+ * Default measurement time of auto-calibrated benchmarks (ns)
+ */
+#define M_BENCH_TARGET_NS 500000000ULL
+
+/**
+ * Maximum number of iterations in a benchmark batch
+ */
+#define M_BENCH_MAX_BATCH 1000000000UL
+
+/**
+ * Default minimum slowdown of the median that is reported as regression
+ */
+#define M_REGRESSION_THRESHOLD 0.05
+
+/**
+ * Mann-Whitney z-score above which a slowdown is significant
+ * (one-sided, alpha = 0.01)
+ */
+#define M_REGRESSION_Z 2.326
+
+/**
+ * Minimum number of samples, in both runs, to look for regressions
+ */
+#define M_REGRESSION_MIN_SAMPLES 8
+
+/**
+ * Number of tests listed in the summary's slowest tests table
+ */
+#define M_SUMMARY_SLOWEST 10
+
+/**
+ * Default maximum output of a test (bytes)
+ */
+#define M_OUTPUT_MAX (64 * 1024)
 
 
 /**
@@ -38,522 +228,4001 @@ struct m_assertion {
 
 
 /* -------------------------------------------------------------------- */
-/*                  Test State Machine implementation                   */
+/*                              Test Output                             */
 /* -------------------------------------------------------------------- */
 
 /**
- * It does the transition between states
- * @param[in] state next state
+ * It returns the maximum output of a test of the given suite
+ * @param[in] m_suite the suite
+ * @return the maximum output in bytes
  */
-static void m_state_go_to(enum m_state_machine state)
+static size_t m_output_max(struct m_suite *m_suite)
 {
-	status.state_prv = status.state_cur;
-	longjmp(status.global_jbuf, state);
+	return m_suite->output_max ? m_suite->output_max : M_OUTPUT_MAX;
 }
 
 /**
- * It set up the suite environment
+ * It writes the test stream, up to the output cap: to the arena in pool
+ * workers, to stdout otherwise. Whatever goes beyond the cap is dropped
+ * @param[in] cookie the test output
+ * @param[in] buf data to write
+ * @param[in] size number of bytes to write
+ * @return always size, dropped bytes are not an error for the stream
  */
-static void m_state_suite_set_up(void)
+static ssize_t m_out_write(void *cookie, const char *buf, size_t size)
 {
-	if (status.m_suite_cur->set_up)
-		status.m_suite_cur->set_up(status.m_suite_cur);
-
-	status.m_test_cur = &status.m_suite_cur->tests[0];
-
-	/* Start test execution */
-	m_state_go_to(M_STATE_TEST_SET_UP);
+	struct m_out *out = cookie;
+	struct m_arena *a = out->arena;
+	size_t keep = out->cap - a->len;
+
+	if (keep > size)
+		keep = size;
+	if (out->buf)
+		memcpy(out->buf + a->len, buf, keep);
+	else
+		fwrite(buf, 1, keep, stdout);
+	a->len += keep;
+
+	return size;
 }
 
 /**
- * It set up the test environment
+ * It opens the test stream. It is not buffered: each message reaches
+ * stdout or the arena as soon as it is printed, so nothing is lost when
+ * the test crashes
+ * @param[in] out the test output
+ * @return 0 on success, -1 on error
  */
-static void m_state_test_set_up(void)
+static int m_out_open(struct m_out *out)
 {
-	status.m_test_cur->suite->total_count++;
+	cookie_io_functions_t io = { .write = m_out_write };
 
-	if (status.m_test_cur->set_up)
-		status.m_test_cur->set_up(status.m_test_cur);
+	out->f = fopencookie(out, "w", io);
+	if (!out->f)
+		return -1;
+	setvbuf(out->f, NULL, _IONBF, 0);
 
-	m_state_go_to(M_STATE_TEST_RUN);
+	return 0;
 }
 
 /**
- * It runs the test procedure
+ * It starts collecting the messages of the running test
  */
-static void m_state_test_run(void)
+static void m_out_start(void)
 {
-	if (status.m_test_cur->suite->flags & M_VERBOSE) {
-		fprintf(stdout, "Suite: %s, Test: %u, Iterations: %u ...\n",
-			status.m_test_cur->suite->name,
-			status.m_test_cur->index,
-			status.m_test_cur->loop);
-		if (status.m_test_cur->desc) {
-			fputs(status.m_test_cur->desc, stdout);
-		}
-		fputc(' ', stdout);
+	struct m_out *out = &status->out;
+	struct m_pool *pool = status->pool;
+
+	if (pool) {
+		out->cap = pool->output_max;
+		out->arena = &pool->arenas[status->worker];
+		out->buf = pool->output + status->worker * pool->output_max;
+	} else {
+		out->cap = m_output_max(status->m_suite_cur);
+		out->arena = &out->local;
+		out->buf = NULL;
 	}
-	if (status.m_test_cur->test) {
-		unsigned int i;
+	out->active = 1;
+}
 
-		for (i = 0; i < status.m_test_cur->loop; ++i) {
-			if (status.m_test_cur->suite->flags & M_VERBOSE)
-				fputc(' ', stdout);
-			status.m_test_cur->test(status.m_test_cur);
-		}
+/**
+ * It gives the stream for the next message: the test stream while a test
+ * is running, stdout otherwise. Once the output cap is reached, messages
+ * are no longer formatted: they are dropped, and counted
+ * @return the stream, NULL when the message must be dropped
+ */
+static FILE *m_out_stream(void)
+{
+	struct m_out *out = status ? &status->out : NULL;
+
+	if (!out || !out->active)
+		return stdout;
+	if (!out->f && m_out_open(out) < 0)
+		return stdout;
+	if (out->arena->dropped) {
+		out->arena->dropped++;
+		return NULL;
 	}
-	if (status.m_test_cur->suite->flags & M_VERBOSE)
-		fputs("\n[Success]\n\n", stdout);
 
-	status.m_test_cur->exit = M_STATE_EXIT_SUCCESS;
-	status.m_test_cur->suite->success_count++;
+	return out->f;
+}
+
+/**
+ * It accounts a message printed on the test stream
+ * @param[in] len message length
+ */
+static void m_out_count(size_t len)
+{
+	struct m_out *out = &status->out;
 
-	m_state_go_to(M_STATE_TEST_TEAR_DOWN);
+	out->arena->printed += len;
+	/* The message crossing the cap gets cut, and it ends the output */
+	if (out->arena->printed > out->cap)
+		out->arena->dropped++;
 }
 
 /**
- * It undo what m_state_test_set_up() did
+ * It prints a message of the running test (see m_out_stream())
+ * @param[in] fmt printf string format
+ * @param[in] args printf parameters
  */
-static void m_state_test_tear_down(void)
+static void m_vout(const char *fmt, va_list args)
 {
-	if (status.m_test_cur->tear_down)
-		status.m_test_cur->tear_down(status.m_test_cur);
+	FILE *f = m_out_stream();
+	int n;
 
-	m_state_go_to(M_STATE_TEST_EXIT);
+	if (!f)
+		return;
+	n = vfprintf(f, fmt, args);
+	if (f != stdout && n > 0)
+		m_out_count(n);
 }
 
+static void m_out(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
 /**
- * It handles error
+ * It prints a message of the running test (see m_out_stream())
+ * @param[in] fmt printf string format
  */
-static void m_state_test_error_skip(void)
+static void m_out(const char *fmt, ...)
 {
-	status.m_test_cur->exit = M_STATE_EXIT_ERROR;
-	switch (status.state_prv) {
-	case M_STATE_SUITE_SET_UP:
-		m_state_go_to(M_STATE_SUITE_TEAR_DOWN);
-	case M_STATE_TEST_SET_UP:
-	case M_STATE_TEST_RUN:
-		/*
-		 * We can jump to TEAR_DOWN state only if the state that
-		 * raised the error was SET_UP or RUN. Any other case is
-		 * wrong (ERROR, SKIP, EXIT) or is not possible to recover
-		 * (TEAR_DOWN, it while loop forever)
-		 */
-		switch (status.state_cur) {
-		case M_STATE_TEST_ERROR:
-			status.m_test_cur->suite->fail_count++;
-			break;
-		case M_STATE_TEST_SKIP:
-			status.m_test_cur->exit = M_STATE_EXIT_SKIP;
-			status.m_test_cur->suite->skip_count++;
+	va_list args;
+
+	va_start(args, fmt);
+	m_vout(fmt, args);
+	va_end(args);
+}
+
+/**
+ * It prints a plain string of the running test, without formatting it
+ * (see m_out_stream())
+ * @param[in] str the string
+ */
+static void m_out_puts(const char *str)
+{
+	FILE *f = m_out_stream();
+
+	if (!f)
+		return;
+	fputs(str, f);
+	if (f != stdout)
+		m_out_count(strlen(str));
+}
+
+/**
+ * It writes an arena on stdout, followed by the note about the dropped
+ * messages, and it empties it. Pool workers share stdout, so it is
+ * written with a single writev() to keep it contiguous
+ * @param[in] a arena accounting
+ * @param[in] buf arena
+ */
+static void m_out_arena_write(struct m_arena *a, char *buf)
+{
+	struct iovec iov[2], *v = iov;
+	int count = 1;
+	char note[80];
+	ssize_t n;
+
+	iov[0].iov_base = buf;
+	iov[0].iov_len = a->len;
+	if (a->dropped) {
+		iov[1].iov_base = note;
+		iov[1].iov_len = snprintf(note, sizeof(note),
+					  "\n  ... output truncated, %zu messages dropped\n",
+					  a->dropped);
+		count++;
+	}
+	while (count) {
+		n = writev(STDOUT_FILENO, v, count);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
 			break;
-		default:
-			/* Should not happen */
-			assert(0);
+		for (; count && (size_t)n >= v->iov_len; v++, count--)
+			n -= v->iov_len;
+		if (count) {
+			v->iov_base = (char *)v->iov_base + n;
+			v->iov_len -= n;
 		}
-		m_state_go_to(M_STATE_TEST_TEAR_DOWN);
-	case M_STATE_SUITE_TEAR_DOWN:
-	case M_STATE_TEST_TEAR_DOWN:
-		m_state_go_to(M_STATE_TEST_EXIT);
-	default:
-		/* Should not happen */
-		assert(0);
 	}
+	memset(a, 0, sizeof(*a));
 }
 
 /**
- * It complete the test execution
+ * It completes the output of the running test: serial runs only add the
+ * note about the dropped messages, pool workers write out their arena
  */
-static void m_state_test_exit(void)
+static void m_out_flush(void)
 {
-	if (status.m_test_cur->index + 1 < status.m_suite_cur->test_count) {
-		status.m_test_cur = &status.m_suite_cur->tests[status.m_test_cur->index + 1];
-		m_state_go_to(M_STATE_TEST_SET_UP);
+	struct m_out *out = &status->out;
+	int err = errno;
+
+	if (!out->f)
+		return;
+	if (out->buf) {
+		/* Whatever the test printed by itself comes first */
+		fflush(stdout);
+		if (out->arena->len || out->arena->dropped)
+			m_out_arena_write(out->arena, out->buf);
 	} else {
-		m_state_go_to(M_STATE_SUITE_TEAR_DOWN);
+		if (out->arena->dropped)
+			fprintf(stdout, "\n  ... output truncated, %zu messages dropped\n",
+				out->arena->dropped);
+		memset(out->arena, 0, sizeof(*out->arena));
 	}
+	errno = err;
 }
 
+
+/* -------------------------------------------------------------------- */
+/*                           Suite Data Files                           */
+/* -------------------------------------------------------------------- */
+
+/*
+ * Data files (history, baseline, cache, last run) are text files shared
+ * among suites. Each line starts with "<suite hash> <test index> <desc
+ * hash>", so that data of tests that changed description are ignored.
+ */
+
 /**
- * It undo what m_state_test_set_up() did
+ * FNV-1a string hash, used to build history keys
+ * @param[in] str string to hash, NULL is the same as an empty string
+ * @return the string hash
  */
-static void m_state_suite_tear_down(void)
+static uint64_t m_hash_str(const char *str)
 {
-	if (status.m_suite_cur->tear_down)
-		status.m_suite_cur->tear_down(status.m_suite_cur);
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	while (str && *str) {
+		h ^= (unsigned char)*str++;
+		h *= 0x100000001b3ULL;
+	}
 
-	m_state_go_to(M_STATE_SUITE_EXIT);
+	return h;
 }
 
 /**
- * It undo what m_state_test_set_up() did
+ * It starts the rewrite of a data file. It creates a temporary file with
+ * all the lines that do not belong to the given suite; the caller appends
+ * the suite lines and commits with m_datafile_commit()
+ * @param[in] path data file path
+ * @param[in] suite_key hash of the suite whose lines must be dropped
+ * @param[out] tmp temporary file path
+ * @param[in] len tmp buffer size
+ * @return the temporary file, NULL on error
  */
-static void m_state_suite_exit(void)
+static FILE *m_datafile_rewrite(const char *path, uint64_t suite_key,
+				char *tmp, size_t len)
 {
-	/* Nothing to do, this is the exit point */
-}
+	char *line = NULL;
+	size_t size = 0;
+	FILE *in, *out;
 
+	snprintf(tmp, len, "%s.%d", path, getpid());
+	out = fopen(tmp, "w");
+	if (!out)
+		return NULL;
 
-/**
- * List of all possible states of the state-machine
- */
-static void (*state_machine[_M_STATE_MAX])(void) = {
-	[M_STATE_SUITE_SET_UP] = m_state_suite_set_up,
-	[M_STATE_TEST_SET_UP] = m_state_test_set_up,
-	[M_STATE_TEST_RUN] = m_state_test_run,
-	[M_STATE_TEST_TEAR_DOWN] = m_state_test_tear_down,
-	[M_STATE_TEST_ERROR] = m_state_test_error_skip,
-	[M_STATE_TEST_SKIP] = m_state_test_error_skip,
-	[M_STATE_TEST_EXIT] = m_state_test_exit,
-	[M_STATE_SUITE_TEAR_DOWN] = m_state_suite_tear_down,
-	[M_STATE_SUITE_EXIT] = m_state_suite_exit,
-};
+	in = fopen(path, "r");
+	while (in && getline(&line, &size, in) > 0) {
+		uint64_t key;
 
+		if (sscanf(line, "%" SCNx64, &key) == 1 && key != suite_key)
+			fputs(line, out);
+	}
+	if (in)
+		fclose(in);
+	free(line);
+
+	return out;
+}
 
 /**
- * It rungs the given test.
- * Running a test means activate the test state machine. This state machine is
- * based on function callback and long-jump. Each state callback knows which are
- * the next possible state and it uses a long-jump to go to the next state.
- * I'm using the callback way because I think is better and cleaner than the
- * switch way. I'm using long-jump to go between states because it is necessary
- * to jump out from error condition, so instead of having transition system I
- * prefer to have an unifor way to go between states
- * @param[in] m_test mamma's test to execute
+ * It replaces the data file with the temporary one
+ * @param[in] out temporary file
+ * @param[in] tmp temporary file path
+ * @param[in] path data file path
  */
-static void m_suite_run_state_machine(struct m_suite *m_suite)
+static void m_datafile_commit(FILE *out, const char *tmp, const char *path)
 {
-	status.m_suite_cur = m_suite;
-	errno = 0;
-
-	status.state_cur = setjmp(status.global_jbuf);
-	assert(status.state_cur < _M_STATE_MAX);
-	state_machine[status.state_cur]();
+	if (fclose(out) == 0)
+		rename(tmp, path);
+	else
+		unlink(tmp);
 }
 
 
 /* -------------------------------------------------------------------- */
-/* Following all implemented test conditions - comment only when needed */
+/*                 Baseline and Regression Detection                    */
 /* -------------------------------------------------------------------- */
 
-static int m_cond_true(va_list args)
+static int m_double_cmp(const void *a, const void *b)
 {
-	return !!va_arg(args, int);
-}
+	double da = *(const double *)a, db = *(const double *)b;
 
-static int m_cond_false(va_list args)
-{
-	return !m_cond_true(args);
+	return da < db ? -1 : da > db;
 }
 
+/*
+ * A baseline line is "<suite hash> <test index> <desc hash> <n> <samples>"
+ * where samples are the benchmark samples (ns per iteration)
+ */
 
-
-static int m_cond_int_equal(va_list args)
+/**
+ * It loads the suite baseline
+ * @param[in] m_suite the suite
+ * @return the per-test baseline, NULL on error
+ */
+static struct m_baseline *m_baseline_load(struct m_suite *m_suite)
 {
-	int a, b;
-
-	a = va_arg(args, long);
-	b = va_arg(args, long);
+	uint64_t suite_key = m_hash_str(m_suite->name), key, desc_key;
+	struct m_baseline *base;
+	unsigned int index, n, i;
+	char *line = NULL, *p;
+	size_t size = 0;
+	int off;
+	FILE *f;
+
+	base = calloc(m_suite->test_count, sizeof(*base));
+	if (!base)
+		return NULL;
+
+	f = fopen(m_suite->baseline, "r");
+	while (f && getline(&line, &size, f) > 0) {
+		if (sscanf(line, "%" SCNx64 " %u %" SCNx64 " %u%n",
+			   &key, &index, &desc_key, &n, &off) != 4)
+			continue;
+		if (key != suite_key || index >= m_suite->test_count ||
+		    base[index].n || !n)
+			continue;
+		base[index].samples = malloc(n * sizeof(double));
+		if (!base[index].samples)
+			continue;
+		for (i = 0, p = line + off; i < n; ++i, p += off)
+			if (sscanf(p, "%lf%n", &base[index].samples[i], &off) != 1)
+				break;
+		if (i != n) {
+			free(base[index].samples);
+			base[index].samples = NULL;
+			continue;
+		}
+		qsort(base[index].samples, n, sizeof(double), m_double_cmp);
+		base[index].desc_key = desc_key;
+		base[index].n = n;
+	}
+	if (f)
+		fclose(f);
+	free(line);
 
-	return (a == b);
+	return base;
 }
 
-static int m_cond_int_not_equal(va_list args)
+/**
+ * It releases the suite baseline
+ * @param[in] base the baseline
+ * @param[in] n number of tests
+ */
+static void m_baseline_free(struct m_baseline *base, unsigned int n)
 {
-	return !m_cond_int_equal(args);
+	unsigned int i;
+
+	for (i = 0; base && i < n; ++i)
+		free(base[i].samples);
+	free(base);
 }
 
-static int m_cond_int_greater_than(va_list args)
+/**
+ * It removes the suite lines from the baseline file: the running suite
+ * is going to record new ones
+ * @param[in] m_suite the suite
+ */
+static void m_baseline_reset(struct m_suite *m_suite)
 {
-	int a, b;
-
-	a = va_arg(args, long);
-	b = va_arg(args, long);
+	char tmp[4096];
+	FILE *out;
 
-	return (a > b);
+	out = m_datafile_rewrite(m_suite->baseline, m_hash_str(m_suite->name),
+				 tmp, sizeof(tmp));
+	if (out)
+		m_datafile_commit(out, tmp, m_suite->baseline);
 }
 
-static int m_cond_int_greater_equal(va_list args)
+/**
+ * It appends the test samples to the baseline file. Each test is
+ * appended with a single write() so that parallel workers do not mix
+ * their lines
+ * @param[in] m_test the test
+ * @param[in] samples benchmark samples
+ * @param[in] n number of samples
+ */
+static void m_baseline_append(struct m_test *m_test, const double *samples,
+			      unsigned int n)
 {
-	va_list args_bis;
-	int cond;
+	size_t len, size = 64 + n * 32;
+	unsigned int i;
+	char *buf;
+	int fd;
 
-	va_copy(args_bis, args);
-	cond = (m_cond_int_greater_than(args) || m_cond_int_equal(args_bis));
-	va_end(args_bis);
+	buf = malloc(size);
+	if (!buf)
+		return;
 
-	return cond;
+	len = snprintf(buf, size, "%016" PRIx64 " %u %016" PRIx64 " %u",
+		       m_hash_str(m_test->suite->name), m_test->index,
+		       m_hash_str(m_test->desc), n);
+	for (i = 0; i < n; ++i)
+		len += snprintf(buf + len, size - len, " %.3f", samples[i]);
+	len += snprintf(buf + len, size - len, "\n");
+
+	fd = open(m_test->suite->baseline, O_WRONLY | O_APPEND | O_CREAT, 0644);
+	if (fd >= 0) {
+		if (write(fd, buf, len) != len)
+			fprintf(stdout, "Cannot record baseline of test %u\n",
+				m_test->index);
+		close(fd);
+	}
+	free(buf);
 }
 
-static int m_cond_int_less_than(va_list args)
+/**
+ * One-sided Mann-Whitney U test: is the current distribution
+ * stochastically greater (slower) than the baseline one?
+ * It uses the normal approximation with tie correction.
+ * @param[in] a baseline samples, sorted
+ * @param[in] n1 number of baseline samples
+ * @param[in] b current samples, sorted
+ * @param[in] n2 number of current samples
+ * @return the z-score, positive when the current samples are slower
+ */
+static double m_mann_whitney_z(const double *a, unsigned int n1,
+			       const double *b, unsigned int n2)
 {
-	return !m_cond_int_greater_equal(args);
+	double rank = 1, rank_b = 0, ties = 0, u, mu, sigma, n = n1 + n2;
+	unsigned int i = 0, j = 0;
+
+	while (i < n1 || j < n2) {
+		double v, t, ta = 0, tb = 0;
+
+		if (j == n2 || (i < n1 && a[i] <= b[j]))
+			v = a[i];
+		else
+			v = b[j];
+		while (i < n1 && a[i] == v)
+			ta++, i++;
+		while (j < n2 && b[j] == v)
+			tb++, j++;
+		t = ta + tb;
+		rank_b += tb * (rank + (t - 1) / 2);
+		ties += t * t * t - t;
+		rank += t;
+	}
+
+	u = rank_b - (double)n2 * (n2 + 1) / 2;
+	mu = (double)n1 * n2 / 2;
+	sigma = sqrt((double)n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1))));
+
+	return sigma > 0 ? (u - mu - 0.5) / sigma : 0;
 }
 
-static int m_cond_int_less_equal(va_list args)
+/**
+ * It records the benchmark samples in the baseline or it compares them
+ * with the baseline, according to the suite options
+ * @param[in] m_test the benchmark
+ * @param[in] samples benchmark samples, sorted
+ * @return 1 when the test is significantly slower than its baseline
+ */
+static int m_baseline_eval(struct m_test *m_test, const double *samples)
 {
-	return !m_cond_int_greater_than(args);
+	struct m_suite *suite = m_test->suite;
+	struct m_baseline *base;
+	double threshold, slowdown, z;
+	unsigned int n = m_test->bench.samples;
+
+	if (!suite->baseline)
+		return 0;
+	if (suite->flags & M_BASELINE_SAVE) {
+		m_baseline_append(m_test, samples, n);
+		return 0;
+	}
+
+	if (!status->baseline)
+		return 0;
+	base = &status->baseline[m_test->index];
+	if (base->n < M_REGRESSION_MIN_SAMPLES || n < M_REGRESSION_MIN_SAMPLES ||
+	    base->desc_key != m_hash_str(m_test->desc))
+		return 0;
+
+	threshold = suite->regression > 0 ?
+		suite->regression : M_REGRESSION_THRESHOLD;
+	m_test->bench.baseline = (base->n & 1) ? base->samples[base->n / 2] :
+		(base->samples[base->n / 2 - 1] + base->samples[base->n / 2]) / 2;
+	slowdown = m_test->bench.median / m_test->bench.baseline - 1;
+	z = m_mann_whitney_z(base->samples, base->n, samples, n);
+	if (z < M_REGRESSION_Z || slowdown < threshold)
+		return 0;
+
+	m_out("\nREGRESSION @ test %u - median %.1f ns -> %.1f ns (%+.1f%%), z = %.2f, p = %.2g",
+		m_test->index, m_test->bench.baseline, m_test->bench.median,
+		slowdown * 100, z, 0.5 * erfc(z / sqrt(2)));
+
+	return 1;
 }
 
-static int m_cond_int_in_range(va_list args)
-{
-	int min, max, val;
 
-	min = va_arg(args, long);
-	max = va_arg(args, long);
-	val = va_arg(args, long);
+static void m_state_go_to(enum m_state_machine state);
+static uint64_t m_time_ns(clockid_t clk);
 
-	return (min <= val && val <= max);
-}
 
-static int m_cond_int_not_in_range(va_list args)
+/* -------------------------------------------------------------------- */
+/*                              Benchmark                               */
+/* -------------------------------------------------------------------- */
+
+/**
+ * It computes the statistics of a set of samples
+ * @param[in,out] samples samples to evaluate, they get sorted
+ * @param[in] n number of samples
+ * @param[out] stats the statistics
+ */
+static void m_stats_compute(double *samples, unsigned int n,
+			    struct m_bench_stats *stats)
 {
-	return !m_cond_int_in_range(args);
-}
+	double sum = 0, sq = 0;
+	unsigned int i;
 
+	memset(stats, 0, sizeof(*stats));
+	if (!n)
+		return;
 
+	qsort(samples, n, sizeof(*samples), m_double_cmp);
+	for (i = 0; i < n; ++i)
+		sum += samples[i];
+	stats->mean = sum / n;
+	for (i = 0; i < n; ++i)
+		sq += (samples[i] - stats->mean) * (samples[i] - stats->mean);
+
+	stats->samples = n;
+	stats->min = samples[0];
+	stats->max = samples[n - 1];
+	stats->stddev = n > 1 ? sqrt(sq / (n - 1)) : 0;
+	stats->median = (n & 1) ? samples[n / 2] :
+		(samples[n / 2 - 1] + samples[n / 2]) / 2;
+	/* nearest-rank percentile */
+	stats->p99 = samples[(unsigned int)ceil(0.99 * n) - 1];
+}
 
-static int m_cond_dbl_equal(va_list args)
+/**
+ * It runs a batch of benchmark iterations
+ * @param[in] m_test the benchmark to run
+ * @param[in] n number of iterations
+ * @return the time spent by the whole batch (ns)
+ */
+static double m_bench_batch(struct m_test *m_test, unsigned long n)
 {
-	double a, b;
+	struct timespec t0, t1;
 
-	a = va_arg(args, double);
-	b = va_arg(args, double);
+	m_test->perf.iterations += n;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &t0);
+	while (n--)
+		m_test->test(m_test);
+	clock_gettime(CLOCK_MONOTONIC_RAW, &t1);
 
-	return (a == b);
+	return (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
 }
 
-static int m_cond_dbl_not_equal(va_list args)
+/**
+ * It looks for the number of iterations that lasts at least the given time.
+ * The number of iterations grows according to the measured cost, with a
+ * margin, but never more than 100 times per round. Calibration rounds
+ * also warm up caches and branch predictors before the measurement
+ * @param[in] m_test the benchmark to calibrate
+ * @param[in] target minimum batch duration (ns)
+ * @return number of iterations per batch
+ */
+static unsigned long m_bench_calibrate(struct m_test *m_test, double target)
 {
-	return !m_cond_dbl_equal(args);
+	unsigned long n = 1, next;
+	double t;
+
+	while (1) {
+		t = m_bench_batch(m_test, n);
+		if (t >= target || n >= M_BENCH_MAX_BATCH)
+			return n;
+
+		next = t > 0 ? target * 1.2 / (t / n) : n * 100;
+		if (next > n * 100)
+			next = n * 100;
+		if (next <= n)
+			next = n + 1;
+		n = next < M_BENCH_MAX_BATCH ? next : M_BENCH_MAX_BATCH;
+	}
 }
 
-static int m_cond_dbl_greater_than(va_list args)
+/**
+ * It runs the test body as a benchmark: the test runs in batches and
+ * each batch is a sample. By default batches are made of a single
+ * iteration; auto-calibrated benchmarks (M_TEST_CALIBRATE) look first for
+ * the batch size that makes all the samples last the suite's bench_ns
+ * @param[in] m_test the benchmark to run
+ */
+static void m_bench_run(struct m_test *m_test)
 {
-	double a, b;
+	unsigned long batch = 1;
+	unsigned int i;
 
-	a = va_arg(args, double);
-	b = va_arg(args, double);
+	status->samples = malloc(m_test->loop * sizeof(*status->samples));
+	if (!status->samples) {
+		m_out("ERROR @ %s() - cannot allocate %u samples\n",
+			__func__, m_test->loop);
+		m_state_go_to(M_STATE_TEST_ERROR);
+	}
 
-	return (a > b);
-}
+	if (m_test->flags & M_TEST_CALIBRATE) {
+		double target = m_test->suite->bench_ns ?
+			m_test->suite->bench_ns : M_BENCH_TARGET_NS;
 
-static int m_cond_dbl_greater_equal(va_list args)
-{
-	va_list args_bis;
-	int cond;
+		batch = m_bench_calibrate(m_test, target / m_test->loop);
+	}
 
-	va_copy(args_bis, args);
-	cond = (m_cond_dbl_greater_than(args) || m_cond_dbl_equal(args_bis));
-	va_end(args_bis);
+	for (i = 0; i < m_test->loop; ++i)
+		status->samples[i] = m_bench_batch(m_test, batch) / batch;
 
-	return cond;
+	m_stats_compute(status->samples, m_test->loop, &m_test->bench);
+	m_test->bench.batch = batch;
+
+	if (m_test->suite->flags & M_VERBOSE)
+		m_out("\nBench: %u x %lu iterations, %.1f ns/iter\n"
+			"  min %.1f ns, median %.1f ns, mean %.1f ns, stddev %.1f ns, p99 %.1f ns",
+			m_test->bench.samples, m_test->bench.batch,
+			m_test->bench.mean,
+			m_test->bench.min, m_test->bench.median,
+			m_test->bench.mean, m_test->bench.stddev,
+			m_test->bench.p99);
 }
 
-static int m_cond_dbl_less_than(va_list args)
+
+/* -------------------------------------------------------------------- */
+/*                     Hardware Performance Counters                    */
+/* -------------------------------------------------------------------- */
+
+#define M_PERF_CACHE(_cache) ((_cache) |				\
+			      (PERF_COUNT_HW_CACHE_OP_READ << 8) |	\
+			      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+/**
+ * perf_event description of each counter
+ */
+static const struct m_perf_event {
+	uint32_t type;
+	uint64_t config;
+	const char *name;
+} m_perf_events[_M_PERF_MAX] = {
+	[M_PERF_CYCLES] = {PERF_TYPE_HARDWARE,
+			   PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+	[M_PERF_INSTRUCTIONS] = {PERF_TYPE_HARDWARE,
+				 PERF_COUNT_HW_INSTRUCTIONS, "instr"},
+	[M_PERF_BRANCH_MISSES] = {PERF_TYPE_HARDWARE,
+				  PERF_COUNT_HW_BRANCH_MISSES, "br-miss"},
+	[M_PERF_L1D_MISSES] = {PERF_TYPE_HW_CACHE,
+			       M_PERF_CACHE(PERF_COUNT_HW_CACHE_L1D), "L1D-miss"},
+	[M_PERF_LLC_MISSES] = {PERF_TYPE_HW_CACHE,
+			       M_PERF_CACHE(PERF_COUNT_HW_CACHE_LL), "LLC-miss"},
+	[M_PERF_DTLB_MISSES] = {PERF_TYPE_HW_CACHE,
+				M_PERF_CACHE(PERF_COUNT_HW_CACHE_DTLB), "dTLB-miss"},
+	[M_PERF_TASK_CLOCK] = {PERF_TYPE_SOFTWARE,
+			       PERF_COUNT_SW_TASK_CLOCK, "task-ns"},
+	[M_PERF_CONTEXT_SWITCHES] = {PERF_TYPE_SOFTWARE,
+				     PERF_COUNT_SW_CONTEXT_SWITCHES, "ctx-sw"},
+	[M_PERF_PAGE_FAULTS] = {PERF_TYPE_SOFTWARE,
+				PERF_COUNT_SW_PAGE_FAULTS, "faults"},
+};
+
+/**
+ * It opens a counter for the calling thread
+ * @param[in] counter the counter to open
+ * @param[in] group group leader file descriptor, -1 to open a leader
+ * @return a file descriptor, -1 on error
+ */
+static int m_perf_event_open(enum m_perf_counter counter, int group)
 {
-	return !m_cond_dbl_greater_equal(args);
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = m_perf_events[counter].type;
+	attr.config = m_perf_events[counter].config;
+	attr.disabled = (group < 0);
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP |
+			   PERF_FORMAT_TOTAL_TIME_ENABLED |
+			   PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	return syscall(SYS_perf_event_open, &attr, 0, -1, group,
+		       PERF_FLAG_FD_CLOEXEC);
 }
 
-static int m_cond_dbl_less_equal(va_list args)
+/**
+ * It opens a group of counters. Members that can't be opened are
+ * left out of the group
+ * @param[in] first first counter, it is the group leader
+ * @param[in] last last counter
+ * @return 0 on success, -1 when the group leader can't be opened
+ */
+static int m_perf_group_open(enum m_perf_counter first,
+			     enum m_perf_counter last)
 {
-	return !m_cond_dbl_greater_than(args);
+	struct m_perf_group *grp = &status->perf;
+	enum m_perf_counter c;
+	int fd;
+
+	grp->n = 0;
+	for (c = first; c <= last; ++c) {
+		fd = m_perf_event_open(c, grp->n ? grp->fd[0] : -1);
+		if (fd < 0) {
+			if (!grp->n)
+				return -1;
+			continue;
+		}
+		grp->fd[grp->n] = fd;
+		grp->id[grp->n++] = c;
+	}
+
+	return 0;
 }
 
-static int m_cond_dbl_in_range(va_list args)
+/**
+ * It opens the counters of the run context: hardware counters when
+ * available, software ones otherwise (e.g. because of perf_event_paranoid
+ * or in virtual machines)
+ */
+static void m_perf_open(void)
 {
-	double min, max, val;
+	if (m_perf_group_open(M_PERF_CYCLES, M_PERF_DTLB_MISSES) == 0) {
+		status->perf.state = 1;
+		return;
+	}
+	if (m_perf_group_open(M_PERF_TASK_CLOCK, M_PERF_PAGE_FAULTS) == 0) {
+		fprintf(stdout, "Hardware performance counters not available (%s), using software events\n",
+			strerror(errno));
+		status->perf.state = 1;
+		return;
+	}
+	fprintf(stdout, "Performance counters not available: %s\n",
+		strerror(errno));
+	status->perf.state = -1;
+}
 
-	min = va_arg(args, double);
-	max = va_arg(args, double);
-	val = va_arg(args, double);
+/**
+ * It closes the counters of the run context
+ */
+static void m_perf_close(void)
+{
+	unsigned int i;
 
-	return (min <= val && val <= max);
+	for (i = 0; i < status->perf.n; ++i)
+		close(status->perf.fd[i]);
+	status->perf.n = 0;
+	status->perf.state = 0;
 }
 
-static int m_cond_dbl_not_in_range(va_list args)
+/**
+ * It starts counting
+ */
+static void m_perf_start(void)
 {
-	return !m_cond_dbl_in_range(args);
+	if (!status->perf.state)
+		m_perf_open();
+	if (status->perf.state < 0)
+		return;
+
+	ioctl(status->perf.fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(status->perf.fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
 }
 
+/**
+ * It stops counting and it accumulates the counters into the test.
+ * Counters are scaled when the kernel had to multiplex them
+ * @param[out] perf test counters
+ */
+static void m_perf_stop(struct m_perf *perf)
+{
+	uint64_t buf[3 + _M_PERF_MAX];
+	unsigned int i;
 
+	if (status->perf.state <= 0)
+		return;
 
-static int m_cond_ptr_null(va_list args)
-{
-	void *ptr;
+	ioctl(status->perf.fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	if (read(status->perf.fd[0], buf, sizeof(buf)) < 0)
+		return;
 
-	ptr = va_arg(args, void*);
+	for (i = 0; i < buf[0] && i < status->perf.n; ++i) {
+		uint64_t val = buf[3 + i];
 
-	return (ptr == NULL);
+		if (buf[2] && buf[2] < buf[1])
+			val = (double)val * buf[1] / buf[2];
+		perf->count[status->perf.id[i]] += val;
+		perf->valid |= (1UL << status->perf.id[i]);
+	}
 }
 
-static int m_cond_ptr_not_null(va_list args)
-{
-	return !m_cond_ptr_null(args);
-}
 
+/* -------------------------------------------------------------------- */
+/*                           Signal Recovery                            */
+/* -------------------------------------------------------------------- */
 
-static int m_cond_mem_eq(va_list args)
-{
-	void *ptr1, *ptr2;
-	size_t size;
+/**
+ * Signals raised by faulty test code. When they are raised by a test
+ * set_up() or test() the test fails and the suite goes on
+ */
+static const int m_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+#define M_SIGNALS_N (sizeof(m_signals) / sizeof(m_signals[0]))
 
-	ptr1 = va_arg(args, void*);
-	ptr2 = va_arg(args, void*);
-	size = va_arg(args, size_t);
+/**
+ * Size of the alternate signal stack, large enough to recover from a
+ * stack overflow
+ */
+#define M_SIGSTACK_SIZE (64 * 1024)
 
-	return (memcmp(ptr1, ptr2, size) == 0);
-}
+/**
+ * Signal sent by the test timeout timer
+ */
+#define M_TIMEOUT_SIGNAL SIGRTMIN
 
-static int m_cond_mem_neq(va_list args)
+/**
+ * Signal sent to pool workers to cancel their running test
+ */
+#define M_CANCEL_SIGNAL (SIGRTMIN + 1)
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+static struct sigaction m_signals_prv[M_SIGNALS_N];
+static struct sigaction m_timeout_prv;
+static struct sigaction m_cancel_prv;
+static unsigned int m_signals_users;
+static unsigned int m_signals_lock;
+
+/**
+ * It returns the short name of a signal (e.g. SIGSEGV)
+ * @param[in] sig signal number
+ * @return the signal name
+ */
+static const char *m_signal_name(int sig)
 {
-	return !m_cond_mem_eq(args);
+	switch (sig) {
+	case SIGSEGV: return "SIGSEGV";
+	case SIGBUS: return "SIGBUS";
+	case SIGFPE: return "SIGFPE";
+	case SIGILL: return "SIGILL";
+	case SIGABRT: return "SIGABRT";
+	case SIGTRAP: return "SIGTRAP";
+	case SIGSYS: return "SIGSYS";
+	case SIGKILL: return "SIGKILL";
+	case SIGTERM: return "SIGTERM";
+	case SIGINT: return "SIGINT";
+	case SIGALRM: return "SIGALRM";
+	case SIGPIPE: return "SIGPIPE";
+	default: return "signal";
+	}
 }
 
-static int m_cond_mem_greater_than(va_list args)
+/**
+ * It hands a fault to the handler installed before ours. Without one the
+ * fault takes its default action, which terminates the process: resetting
+ * the disposition of this signal does not matter to other threads
+ * @param[in] sig signal number
+ * @param[in] info signal information
+ * @param[in] ucontext interrupted context
+ */
+static void m_signal_chain(int sig, siginfo_t *info, void *ucontext)
 {
-	void *a, *b;
-	size_t n;
+	const struct sigaction *prv = NULL;
+	unsigned int i;
 
-	a = va_arg(args, void*);
-	b = va_arg(args, void*);
-	n = va_arg(args, size_t);
+	for (i = 0; i < M_SIGNALS_N; ++i)
+		if (m_signals[i] == sig)
+			prv = &m_signals_prv[i];
+
+	if (prv && prv->sa_handler == SIG_IGN && info->si_code <= 0)
+		return; /* sent by kill(), it is ignored */
+	if (prv && prv->sa_handler != SIG_DFL && prv->sa_handler != SIG_IGN) {
+		if (prv->sa_flags & SA_SIGINFO)
+			prv->sa_sigaction(sig, info, ucontext);
+		else
+			prv->sa_handler(sig);
+		return;
+	}
 
-	return (memcmp(a, b, n) > 0);
+	signal(sig, SIG_DFL);
+	raise(sig);
 }
 
+/**
+ * It turns a fault raised by the running test into a test error. The
+ * fault is recorded here and reported out of the signal context, by the
+ * error state. Pool workers (and so isolated tests) do not recover: the
+ * test may have corrupted their memory, so they die and the parent
+ * reports the test and replaces them. Faults raised elsewhere go to the
+ * previous handler (or default action)
+ * @param[in] sig signal number
+ * @param[in] info signal information
+ * @param[in] ucontext interrupted context
+ */
+static void m_signal_handler(int sig, siginfo_t *info, void *ucontext)
+{
+	if (status && !status->pool &&
+	    (status->state_cur == M_STATE_TEST_SET_UP ||
+	     status->state_cur == M_STATE_TEST_RUN)) {
+		status->fault_sig = sig;
+		status->fault_addr = info->si_addr;
+		m_state_go_to(M_STATE_TEST_ERROR);
+	}
+
+	m_signal_chain(sig, info, ucontext);
+}
 
 /**
- * Implement the function instead of re-use the others (like we did for
- * int and double) in order to avoid double memory scanning
+ * It stops the running test when its timeout expires. The test may be
+ * anywhere (even within stdio or malloc), so the timeout is reported
+ * out of the signal context, by the error state. Expirations of timers
+ * disarmed in the meanwhile are ignored
+ * @param[in] sig signal number
+ * @param[in] info signal information
+ * @param[in] ucontext interrupted context
  */
-static int m_cond_mem_greater_equal(va_list args)
+static void m_timeout_handler(int sig, siginfo_t *info, void *ucontext)
 {
-	void *a, *b;
-	size_t n;
+	if (!status || !status->deadline ||
+	    m_time_ns(CLOCK_MONOTONIC) < status->deadline)
+		return;
+	status->deadline = 0;
+	if (status->state_cur != M_STATE_TEST_SET_UP &&
+	    status->state_cur != M_STATE_TEST_RUN)
+		return;
 
-	a = va_arg(args, void*);
-	b = va_arg(args, void*);
-	n = va_arg(args, size_t);
+	status->timed_out = 1;
+	m_state_go_to(M_STATE_TEST_ERROR);
+}
 
-	return (memcmp(a, b, n) >= 0);
+/**
+ * It stops the running test of a pool worker because the run has been
+ * cancelled. The test does not count as run
+ * @param[in] sig signal number
+ * @param[in] info signal information
+ * @param[in] ucontext interrupted context
+ */
+static void m_cancel_handler(int sig, siginfo_t *info, void *ucontext)
+{
+	if (!status || !status->pool ||
+	    (status->state_cur != M_STATE_TEST_SET_UP &&
+	     status->state_cur != M_STATE_TEST_RUN))
+		return;
+
+	status->cancelled = 1;
+	m_state_go_to(M_STATE_TEST_ERROR);
 }
 
-static int m_cond_mem_less_than(va_list args)
+/**
+ * It starts the timeout of the running test, if any. The timer sends
+ * its signal to the calling thread only
+ */
+static void m_timeout_arm(void)
 {
-	return !m_cond_mem_greater_equal(args);
+	unsigned long ms = status->m_test_cur->timeout_ms;
+	struct itimerspec its;
+	struct sigevent sev;
+
+	if (!ms)
+		ms = status->m_suite_cur->timeout_ms;
+	if (!ms)
+		return;
+
+	if (!status->timer_state) {
+		memset(&sev, 0, sizeof(sev));
+		sev.sigev_notify = SIGEV_THREAD_ID;
+		sev.sigev_signo = M_TIMEOUT_SIGNAL;
+		sev.sigev_notify_thread_id = syscall(SYS_gettid);
+		status->timer_state = timer_create(CLOCK_MONOTONIC, &sev,
+						   &status->timer) ? -1 : 1;
+		if (status->timer_state < 0)
+			fprintf(stdout, "Cannot create timeout timer: %s\n",
+				strerror(errno));
+	}
+	if (status->timer_state < 0)
+		return;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = ms / 1000;
+	its.it_value.tv_nsec = (ms % 1000) * 1000000;
+	status->deadline = m_time_ns(CLOCK_MONOTONIC) + ms * 1000000ULL;
+	timer_settime(status->timer, 0, &its, NULL);
 }
 
-static int m_cond_mem_less_equal(va_list args)
+/**
+ * It stops the timeout of the running test
+ */
+static void m_timeout_disarm(void)
 {
-	return !m_cond_mem_greater_than(args);
+	struct itimerspec its;
+
+	if (!status->deadline)
+		return;
+	status->deadline = 0;
+	memset(&its, 0, sizeof(its));
+	timer_settime(status->timer, 0, &its, NULL);
 }
 
-static int m_cond_mem_in_range(va_list args)
+/**
+ * It installs the signal handlers (only once for all the threads) and
+ * the alternate signal stack of the calling thread
+ */
+static void m_signal_install(void)
 {
-	void *min, *max, *val;
-	size_t n;
+	struct sigaction sa;
+	stack_t ss;
+	unsigned int i;
 
-	min = va_arg(args, void*);
-	max = va_arg(args, void*);
-	val = va_arg(args, void*);
-	n = va_arg(args, size_t);
+	while (__atomic_exchange_n(&m_signals_lock, 1, __ATOMIC_ACQUIRE))
+		sched_yield();
+	if (!m_signals_users++) {
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_sigaction = m_signal_handler;
+		/* We never return from the handler, do not keep it blocked */
+		sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_NODEFER;
+		sigemptyset(&sa.sa_mask);
+		for (i = 0; i < M_SIGNALS_N; ++i)
+			sigaction(m_signals[i], &sa, &m_signals_prv[i]);
+		sa.sa_sigaction = m_timeout_handler;
+		sigaction(M_TIMEOUT_SIGNAL, &sa, &m_timeout_prv);
+		sa.sa_sigaction = m_cancel_handler;
+		sigaction(M_CANCEL_SIGNAL, &sa, &m_cancel_prv);
+	}
+	__atomic_store_n(&m_signals_lock, 0, __ATOMIC_RELEASE);
 
-	return (memcmp(min, val, n) <= 0 && memcmp(val, max, n) <= 0);
+	/* Keep the thread's alternate stack, if any */
+	if (sigaltstack(NULL, &status->sigstack_prv) < 0 ||
+	    !(status->sigstack_prv.ss_flags & SS_DISABLE))
+		return;
+	status->sigstack = malloc(M_SIGSTACK_SIZE);
+	if (!status->sigstack)
+		return;
+	ss.ss_sp = status->sigstack;
+	ss.ss_size = M_SIGSTACK_SIZE;
+	ss.ss_flags = 0;
+	if (sigaltstack(&ss, NULL) < 0) {
+		free(status->sigstack);
+		status->sigstack = NULL;
+	}
 }
 
 /**
- * Implement the function instead of re-use the others (like we did for
- * int and double) in order to avoid double memory scanning
+ * It undoes m_signal_install()
  */
-static int m_cond_mem_not_in_range(va_list args)
+static void m_signal_uninstall(void)
 {
-	void *min, *max, *val;
-	size_t n;
+	unsigned int i;
 
-	min = va_arg(args, void*);
-	max = va_arg(args, void*);
-	val = va_arg(args, void*);
-	n = va_arg(args, size_t);
+	if (status->timer_state > 0)
+		timer_delete(status->timer);
+	status->timer_state = 0;
+	if (status->sigstack) {
+		sigaltstack(&status->sigstack_prv, NULL);
+		free(status->sigstack);
+		status->sigstack = NULL;
+	}
 
-	return (memcmp(min, val, n) > 0 || memcmp(val, max, n) > 0);
+	while (__atomic_exchange_n(&m_signals_lock, 1, __ATOMIC_ACQUIRE))
+		sched_yield();
+	if (!--m_signals_users) {
+		for (i = 0; i < M_SIGNALS_N; ++i)
+			sigaction(m_signals[i], &m_signals_prv[i], NULL);
+		sigaction(M_TIMEOUT_SIGNAL, &m_timeout_prv, NULL);
+		sigaction(M_CANCEL_SIGNAL, &m_cancel_prv, NULL);
+	}
+	__atomic_store_n(&m_signals_lock, 0, __ATOMIC_RELEASE);
 }
 
 
-static int m_cond_str_eq(va_list args)
-{
-	char *ptr1, *ptr2;
+/* -------------------------------------------------------------------- */
+/*                        Kept Suite Environments                       */
+/* -------------------------------------------------------------------- */
 
-	ptr1 = va_arg(args, char*);
-	ptr2 = va_arg(args, char*);
+/**
+ * Suite environment kept after a run (M_KEEP_SET_UP)
+ */
+struct m_kept {
+	struct m_kept *next; /**< next kept environment */
+	char *name; /**< suite name */
+	void *private; /**< suite private data built by set_up() */
+};
+
+static struct m_kept *m_kept_list;
+static unsigned int m_kept_lock;
+
+static void m_kept_lock_get(void)
+{
+	while (__atomic_exchange_n(&m_kept_lock, 1, __ATOMIC_ACQUIRE))
+		sched_yield();
+}
 
-	return (strcmp(ptr1, ptr2) == 0);
+static void m_kept_lock_put(void)
+{
+	__atomic_store_n(&m_kept_lock, 0, __ATOMIC_RELEASE);
 }
 
-static int m_cond_str_neq(va_list args)
+/**
+ * It takes the kept environment of a suite out of the list
+ * @param[in] name suite name
+ * @return the kept environment, NULL if there is none
+ */
+static struct m_kept *m_kept_take(const char *name)
 {
-	return !m_cond_str_eq(args);
+	struct m_kept **p, *kept = NULL;
+
+	m_kept_lock_get();
+	for (p = &m_kept_list; *p; p = &(*p)->next) {
+		if (strcmp((*p)->name, name))
+			continue;
+		kept = *p;
+		*p = kept->next;
+		break;
+	}
+	m_kept_lock_put();
+
+	return kept;
 }
 
-static int m_cond_str_greater_than(va_list args)
+/**
+ * It keeps the environment of a suite for its next run
+ * @param[in] name suite name
+ * @param[in] private suite private data
+ * @return 0 on success, -1 on error
+ */
+static int m_kept_put(const char *name, void *private)
 {
-	char *a, *b;
+	struct m_kept *kept;
+
+	kept = malloc(sizeof(*kept));
+	if (!kept)
+		return -1;
+	kept->name = strdup(name);
+	if (!kept->name) {
+		free(kept);
+		return -1;
+	}
+	kept->private = private;
 
-	a = va_arg(args, char*);
-	b = va_arg(args, char*);
+	m_kept_lock_get();
+	kept->next = m_kept_list;
+	m_kept_list = kept;
+	m_kept_lock_put();
 
-	return (strcmp(a, b) > 0);
+	return 0;
 }
 
 
+/* -------------------------------------------------------------------- */
+/*                  Test State Machine implementation                   */
+/* -------------------------------------------------------------------- */
+
+static int m_pool_plan(struct m_pool *pool, struct m_suite *m_suite);
+static void m_pool_run(void);
+static void m_pool_publish(struct m_test *m_test);
+static struct m_test *m_pool_next(void);
+
 /**
- * Implement the function instead of re-use the others (like we did for
- * int and double) in order to avoid double strory scanning
+ * It returns the current time of the given clock
+ * @param[in] clk clock to read
+ * @return the time in nanoseconds
  */
-static int m_cond_str_greater_equal(va_list args)
+static uint64_t m_time_ns(clockid_t clk)
 {
-	char *a, *b;
+	struct timespec ts;
 
-	a = va_arg(args, char*);
-	b = va_arg(args, char*);
+	clock_gettime(clk, &ts);
 
-	return (strcmp(a, b) >= 0);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
 
-static int m_cond_str_less_than(va_list args)
+/**
+ * It tells if the CPU time of the test phases is measured: the thread CPU
+ * clock is a system call, unlike the monotonic one, so it is read only
+ * when asked for or when the verbose summary shows it
+ * @return 1 when the CPU time is measured, 0 otherwise
+ */
+static int m_time_cpu(void)
 {
-	return !m_cond_str_greater_equal(args);
+	return !!(status->m_suite_cur->flags & (M_CPU_TIME | M_VERBOSE));
 }
 
-static int m_cond_str_less_equal(va_list args)
+/**
+ * It starts measuring the test phases
+ */
+static void m_time_start(void)
 {
-	return !m_cond_str_greater_than(args);
+	status->phase_start.wall = m_time_ns(CLOCK_MONOTONIC);
+	if (m_time_cpu())
+		status->phase_start.cpu = m_time_ns(CLOCK_THREAD_CPUTIME_ID);
 }
 
-static int m_cond_str_in_range(va_list args)
+/**
+ * It accounts the time spent in the current state, if it is a test phase.
+ * This runs on every transition, so a phase interrupted by an error is
+ * measured as well. The test phases follow each other, so the end of one
+ * is the start of the next
+ */
+static void m_time_stop(void)
 {
-	char *min, *max, *val;
+	struct m_time *t, now = { 0 };
 
-	min = va_arg(args, char*);
-	max = va_arg(args, char*);
-	val = va_arg(args, char*);
+	switch (status->state_cur) {
+	case M_STATE_TEST_SET_UP:
+		t = &status->m_test_cur->time_set_up;
+		break;
+	case M_STATE_TEST_RUN:
+		if (status->m_suite_cur->flags & M_PERF)
+			m_perf_stop(&status->m_test_cur->perf);
+		t = &status->m_test_cur->time_test;
+		break;
+	case M_STATE_TEST_TEAR_DOWN:
+		t = &status->m_test_cur->time_tear_down;
+		break;
+	default:
+		return;
+	}
 
-	return (strcmp(min, val) <= 0 && strcmp(val, max) <= 0);
+	now.wall = m_time_ns(CLOCK_MONOTONIC);
+	t->wall += now.wall - status->phase_start.wall;
+	if (m_time_cpu()) {
+		now.cpu = m_time_ns(CLOCK_THREAD_CPUTIME_ID);
+		t->cpu += now.cpu - status->phase_start.cpu;
+	}
+	status->phase_start = now;
 }
 
 /**
- * Implement the function instead of re-use the others (like we did for
- * int and double) in order to avoid double string scanning
+ * It tells if a test has to run. Disabled and cached tests do not run
+ * @param[in] m_test the test
+ * @return 1 when the test has to run, 0 otherwise
  */
-static int m_cond_str_not_in_range(va_list args)
+static int m_test_runnable(struct m_test *m_test)
 {
-	char *min, *max, *val;
-
-	min = va_arg(args, char*);
-	max = va_arg(args, char*);
-	val = va_arg(args, char*);
+	return !(m_test->flags & M_TEST_DISABLED) &&
+	       m_test->exit != M_STATE_EXIT_CACHED;
+}
 
-	return (strcmp(min, val) > 0 || strcmp(val, max) > 0);
+/**
+ * It tells if a test failed
+ * @param[in] m_test the test
+ * @return 1 when the test failed, 0 otherwise
+ */
+static int m_test_failed(struct m_test *m_test)
+{
+	return m_test->exit == M_STATE_EXIT_ERROR ||
+	       m_test->exit == M_STATE_EXIT_TIMEOUT ||
+	       m_test->exit == M_STATE_EXIT_REGRESSION;
+}
+
+/**
+ * It returns the number of failures that stops the suite
+ * @param[in] m_suite the suite
+ * @return the failure budget, 0 for no limit
+ */
+static unsigned int m_fail_budget(struct m_suite *m_suite)
+{
+	if (m_suite->fail_budget)
+		return m_suite->fail_budget;
+
+	return (m_suite->flags & M_FAIL_FAST) ? 1 : 0;
+}
+
+/**
+ * It returns the next test to run in the run order
+ * @return the next test to run, NULL when there are no more tests
+ */
+static struct m_test *m_run_next(void)
+{
+	struct m_suite *m_suite = status->m_suite_cur;
+	unsigned int index;
+
+	while (status->order_pos < m_suite->test_count) {
+		index = status->order ? status->order[status->order_pos] :
+					status->order_pos;
+		status->order_pos++;
+		if (m_test_runnable(&m_suite->tests[index]))
+			return &m_suite->tests[index];
+	}
+
+	return NULL;
+}
+
+/**
+ * It leaves the running state from wherever the test is (assertions,
+ * signal handlers, skips) and it resumes the state machine at the given
+ * state. Normal transitions are the return value of the state callbacks
+ * @param[in] state next state
+ */
+static void m_state_go_to(enum m_state_machine state)
+{
+	m_time_stop();
+	status->state_prv = status->state_cur;
+	siglongjmp(status->global_jbuf, state);
+}
+
+/**
+ * It set up the suite environment
+ */
+static enum m_state_machine m_state_suite_set_up(void)
+{
+	struct m_kept *kept = NULL;
+
+	if ((status->m_suite_cur->flags & M_KEEP_SET_UP) &&
+	    status->m_suite_cur->name)
+		kept = m_kept_take(status->m_suite_cur->name);
+	if (kept) {
+		status->m_suite_cur->private = kept->private;
+		free(kept->name);
+		free(kept);
+	} else if (status->m_suite_cur->set_up) {
+		status->m_suite_cur->set_up(status->m_suite_cur);
+	}
+
+	if (status->pool) {
+		/* Tests run in the workers, we only wait for them */
+		m_pool_run();
+		return M_STATE_SUITE_TEAR_DOWN;
+	}
+
+	status->order_pos = 0;
+	status->m_test_cur = m_run_next();
+	if (!status->m_test_cur)
+		return M_STATE_SUITE_TEAR_DOWN;
+
+	/* Start test execution */
+	return M_STATE_TEST_SET_UP;
+}
+
+/**
+ * It set up the test environment
+ */
+static enum m_state_machine m_state_test_set_up(void)
+{
+	m_count_inc(status->m_test_cur->suite->total_count);
+	m_out_start();
+	if (status->pool)
+		status->pool->current[status->worker] = status->m_test_cur->index;
+
+	m_timeout_arm();
+	m_time_start();
+	if (status->m_test_cur->set_up)
+		status->m_test_cur->set_up(status->m_test_cur);
+
+	return M_STATE_TEST_RUN;
+}
+
+/**
+ * It runs the test procedure
+ */
+static enum m_state_machine m_state_test_run(void)
+{
+	if (status->m_test_cur->suite->flags & M_VERBOSE) {
+		m_out("Suite: %s, Test: %u, Iterations: %u ...\n",
+		      status->m_test_cur->suite->name,
+		      status->m_test_cur->index,
+		      status->m_test_cur->loop);
+		if (status->m_test_cur->desc) {
+			m_out_puts(status->m_test_cur->desc);
+		}
+		m_out_puts(" ");
+	}
+	if (status->m_suite_cur->flags & M_PERF)
+		m_perf_start();
+	if (status->m_test_cur->test &&
+	    (status->m_test_cur->flags & M_TEST_BENCH)) {
+		m_bench_run(status->m_test_cur);
+	} else if (status->m_test_cur->test) {
+		unsigned int i;
+
+		for (i = 0; i < status->m_test_cur->loop; ++i) {
+			if (status->m_test_cur->suite->flags & M_VERBOSE)
+				m_out_puts(" ");
+			status->m_test_cur->perf.iterations++;
+			status->m_test_cur->test(status->m_test_cur);
+		}
+	}
+	if ((status->m_test_cur->flags & M_TEST_BENCH) && status->samples &&
+	    m_baseline_eval(status->m_test_cur, status->samples)) {
+		if (status->m_test_cur->suite->flags & M_VERBOSE)
+			m_out_puts("\n[Regression]\n\n");
+		else
+			m_out_puts("\n");
+
+		status->m_test_cur->exit = M_STATE_EXIT_REGRESSION;
+		m_count_inc(status->m_test_cur->suite->regression_count);
+		return M_STATE_TEST_TEAR_DOWN;
+	}
+
+	if (status->m_test_cur->suite->flags & M_VERBOSE)
+		m_out_puts("\n[Success]\n\n");
+
+	status->m_test_cur->exit = M_STATE_EXIT_SUCCESS;
+	m_count_inc(status->m_test_cur->suite->success_count);
+
+	return M_STATE_TEST_TEAR_DOWN;
+}
+
+/**
+ * It undo what m_state_test_set_up() did
+ */
+static enum m_state_machine m_state_test_tear_down(void)
+{
+	m_timeout_disarm();
+	if (status->m_test_cur->tear_down)
+		status->m_test_cur->tear_down(status->m_test_cur);
+
+	return M_STATE_TEST_EXIT;
+}
+
+/**
+ * It handles error
+ */
+static enum m_state_machine m_state_test_error_skip(void)
+{
+	status->m_test_cur->exit = M_STATE_EXIT_ERROR;
+	switch (status->state_prv) {
+	case M_STATE_SUITE_SET_UP:
+		return M_STATE_SUITE_TEAR_DOWN;
+	case M_STATE_TEST_SET_UP:
+	case M_STATE_TEST_RUN:
+		/*
+		 * We can jump to TEAR_DOWN state only if the state that
+		 * raised the error was SET_UP or RUN. Any other case is
+		 * wrong (ERROR, SKIP, EXIT) or is not possible to recover
+		 * (TEAR_DOWN, it while loop forever)
+		 */
+		switch (status->state_cur) {
+		case M_STATE_TEST_ERROR:
+			if (status->cancelled) {
+				status->cancelled = 0;
+				status->m_test_cur->exit = M_STATE_EXIT_NORUN;
+				break;
+			}
+			if (status->fault_sig) {
+				m_out("ERROR @ %s() - test %u %s (%s)",
+				      status->state_prv == M_STATE_TEST_RUN ?
+				      "test" : "set_up",
+				      status->m_test_cur->index,
+				      m_signal_name(status->fault_sig),
+				      strsignal(status->fault_sig));
+				if (status->fault_sig != SIGABRT)
+					m_out(" at address %p",
+					      status->fault_addr);
+				m_out_puts("\n");
+				status->fault_sig = 0;
+			}
+			if (status->timed_out) {
+				m_out("ERROR @ %s() - test %u timed out\n",
+				      status->state_prv == M_STATE_TEST_RUN ?
+				      "test" : "set_up",
+				      status->m_test_cur->index);
+				status->timed_out = 0;
+				status->m_test_cur->exit = M_STATE_EXIT_TIMEOUT;
+				m_count_inc(status->m_test_cur->suite->timeout_count);
+				break;
+			}
+			m_count_inc(status->m_test_cur->suite->fail_count);
+			break;
+		case M_STATE_TEST_SKIP:
+			status->m_test_cur->exit = M_STATE_EXIT_SKIP;
+			m_count_inc(status->m_test_cur->suite->skip_count);
+			break;
+		default:
+			/* Should not happen */
+			assert(0);
+		}
+		return M_STATE_TEST_TEAR_DOWN;
+	case M_STATE_SUITE_TEAR_DOWN:
+	case M_STATE_TEST_TEAR_DOWN:
+		return M_STATE_TEST_EXIT;
+	default:
+		/* Should not happen */
+		assert(0);
+		return M_STATE_SUITE_EXIT;
+	}
+}
+
+/**
+ * It complete the test execution
+ */
+static enum m_state_machine m_state_test_exit(void)
+{
+	unsigned int budget;
+
+	m_out_flush();
+	status->out.active = 0;
+	free(status->samples);
+	status->samples = NULL;
+
+	if (status->pool) {
+		/* Workers do not own the suite, the parent tears it down */
+		m_pool_publish(status->m_test_cur);
+		if (status->pool->batch &&
+		    ++status->batch_done >= status->pool->batch)
+			return M_STATE_SUITE_EXIT;
+		status->m_test_cur = m_pool_next();
+		if (status->m_test_cur)
+			return M_STATE_TEST_SET_UP;
+		return M_STATE_SUITE_EXIT;
+	}
+
+	budget = m_fail_budget(status->m_suite_cur);
+	if (budget && status->m_suite_cur->fail_count +
+		      status->m_suite_cur->timeout_count +
+		      status->m_suite_cur->regression_count >= budget)
+		return M_STATE_SUITE_TEAR_DOWN;
+
+	status->m_test_cur = m_run_next();
+	if (status->m_test_cur)
+		return M_STATE_TEST_SET_UP;
+	else
+		return M_STATE_SUITE_TEAR_DOWN;
+}
+
+/**
+ * It undo what m_state_test_set_up() did
+ */
+static enum m_state_machine m_state_suite_tear_down(void)
+{
+	if ((status->m_suite_cur->flags & M_KEEP_SET_UP) &&
+	    status->m_suite_cur->name &&
+	    !m_kept_put(status->m_suite_cur->name,
+			status->m_suite_cur->private))
+		return M_STATE_SUITE_EXIT;
+
+	if (status->m_suite_cur->tear_down)
+		status->m_suite_cur->tear_down(status->m_suite_cur);
+
+	return M_STATE_SUITE_EXIT;
+}
+
+/**
+ * It undo what m_state_test_set_up() did
+ */
+static enum m_state_machine m_state_suite_exit(void)
+{
+	/* Nothing to do, this is the exit point */
+	return M_STATE_SUITE_EXIT;
+}
+
+
+/**
+ * List of all possible states of the state-machine
+ */
+static enum m_state_machine (*state_machine[_M_STATE_MAX])(void) = {
+	[M_STATE_SUITE_SET_UP] = m_state_suite_set_up,
+	[M_STATE_TEST_SET_UP] = m_state_test_set_up,
+	[M_STATE_TEST_RUN] = m_state_test_run,
+	[M_STATE_TEST_TEAR_DOWN] = m_state_test_tear_down,
+	[M_STATE_TEST_ERROR] = m_state_test_error_skip,
+	[M_STATE_TEST_SKIP] = m_state_test_error_skip,
+	[M_STATE_TEST_EXIT] = m_state_test_exit,
+	[M_STATE_SUITE_TEAR_DOWN] = m_state_suite_tear_down,
+	[M_STATE_SUITE_EXIT] = m_state_suite_exit,
+};
+
+
+/**
+ * It rungs the given test.
+ * Running a test means activate the test state machine. This state machine is
+ * based on function callback. Each state callback knows which are the next
+ * possible states and it returns the next one, so the normal path is a plain
+ * dispatch loop. Long-jumps are used only to get out from error conditions
+ * (failed assertions, skips, signals, timeouts): they land here, at the
+ * sigsetjmp(), and the loop continues from the state they asked for
+ * @param[in] m_test mamma's test to execute
+ */
+static void m_suite_run_state_machine(struct m_suite *m_suite,
+				      enum m_state_machine entry)
+{
+	int state;
+
+	status->m_suite_cur = m_suite;
+	errno = 0;
+
+	/*
+	 * siglongjmp() can't deliver 0, so the first return is the entry
+	 * point. The signal mask is not saved: it costs a system call on
+	 * every jump and recovered signals are never blocked
+	 */
+	state = sigsetjmp(status->global_jbuf, 0);
+	if (!state)
+		state = entry;
+	do {
+		assert(state < _M_STATE_MAX);
+		status->state_cur = state;
+		state = state_machine[state]();
+		m_time_stop();
+		status->state_prv = status->state_cur;
+	} while (status->state_cur != M_STATE_SUITE_EXIT);
+}
+
+
+/* -------------------------------------------------------------------- */
+/*                    Test Duration History and Scheduling              */
+/* -------------------------------------------------------------------- */
+
+/**
+ * @return the total wall-clock time spent by a test
+ */
+static uint64_t m_test_wall(struct m_test *m_test)
+{
+	return m_test->time_set_up.wall + m_test->time_test.wall +
+		m_test->time_tear_down.wall;
+}
+
+/**
+ * It loads the tests duration from the suite history file.
+ * A history line is "<suite hash> <test index> <desc hash> <duration ns>"
+ * @param[in] m_suite the suite
+ * @param[out] est per-test durations, untouched when unknown
+ * @return number of tests with a known duration
+ */
+static unsigned int m_history_load(struct m_suite *m_suite, uint64_t *est)
+{
+	uint64_t suite_key, desc_key, ns;
+	unsigned int index, known = 0;
+	char line[128];
+	FILE *f;
+
+	f = fopen(m_suite->history, "r");
+	if (!f)
+		return 0;
+
+	suite_key = m_hash_str(m_suite->name);
+	while (fgets(line, sizeof(line), f)) {
+		uint64_t key;
+
+		if (sscanf(line, "%" SCNx64 " %u %" SCNx64 " %" SCNu64,
+			   &key, &index, &desc_key, &ns) != 4)
+			continue;
+		if (key != suite_key || index >= m_suite->test_count)
+			continue;
+		if (desc_key != m_hash_str(m_suite->tests[index].desc))
+			continue; /* the test changed */
+		est[index] = ns;
+		known++;
+	}
+	fclose(f);
+
+	return known;
+}
+
+/**
+ * It updates the suite history file with the durations of the last run.
+ * Lines of other suites are preserved. Durations are smoothed with the
+ * previous ones in order to not over-react to a single slow run
+ * @param[in] m_suite the suite
+ */
+static void m_history_save(struct m_suite *m_suite)
+{
+	uint64_t suite_key = m_hash_str(m_suite->name);
+	char tmp[4096];
+	uint64_t *est;
+	unsigned int i;
+	FILE *out;
+
+	est = calloc(m_suite->test_count, sizeof(*est));
+	if (!est)
+		return;
+	m_history_load(m_suite, est);
+
+	out = m_datafile_rewrite(m_suite->history, suite_key, tmp, sizeof(tmp));
+	if (!out)
+		goto out;
+
+	for (i = 0; i < m_suite->test_count; ++i) {
+		uint64_t ns = est[i], last = m_test_wall(&m_suite->tests[i]);
+
+		if (m_suite->tests[i].exit != M_STATE_EXIT_NORUN && last)
+			ns = ns ? (ns + last) / 2 : last;
+		if (!ns)
+			continue;
+		fprintf(out, "%016" PRIx64 " %u %016" PRIx64 " %" PRIu64 "\n",
+			suite_key, i, m_hash_str(m_suite->tests[i].desc), ns);
+	}
+
+	m_datafile_commit(out, tmp, m_suite->history);
+out:
+	free(est);
+}
+
+struct m_sched_item {
+	uint64_t est; /**< expected duration */
+	unsigned int index; /**< test index */
+	unsigned int prio; /**< test priority, higher first */
+};
+
+static int m_sched_item_cmp(const void *a, const void *b)
+{
+	const struct m_sched_item *ia = a, *ib = b;
+
+	if (ia->prio != ib->prio)
+		return ia->prio < ib->prio ? 1 : -1;
+	if (ia->est != ib->est)
+		return ia->est < ib->est ? 1 : -1; /* longest first */
+	return ia->index < ib->index ? -1 : ia->index > ib->index;
+}
+
+/**
+ * It distributes the tests among the worker queues.
+ * Tests are sorted by their expected duration (longest first) and
+ * assigned to the worker with the lowest load (LPT scheduling), so
+ * long tests start first and they do not end up on the critical path.
+ * Tests without history are expected to last as much as the average.
+ * Without history at all this is a plain round-robin in test order.
+ * @param[in] pool worker pool
+ * @param[in] m_suite the suite to distribute
+ * @return 0 on success, -1 on error
+ */
+static int m_pool_plan(struct m_pool *pool, struct m_suite *m_suite)
+{
+	unsigned int i, w, n = m_suite->test_count, m = 0, known = 0;
+	struct m_sched_item *items;
+	uint64_t *est, *load, avg = 1, sum = 0;
+	unsigned int *owner;
+
+	est = calloc(n, sizeof(*est));
+	items = calloc(n, sizeof(*items));
+	owner = calloc(n, sizeof(*owner));
+	load = calloc(pool->worker_count, sizeof(*load));
+	if (!est || !items || !owner || !load)
+		goto err;
+
+	if (m_suite->history)
+		known = m_history_load(m_suite, est);
+	for (i = 0; i < n; ++i)
+		sum += est[i];
+	if (known)
+		avg = sum / known;
+
+	for (i = 0; i < n; ++i) {
+		if ((m_suite->tests[i].flags & M_TEST_DISABLED) ||
+		    m_suite->tests[i].exit == M_STATE_EXIT_CACHED)
+			continue;
+		items[m].est = est[i] ? est[i] : avg;
+		items[m].prio = status->prio ? status->prio[i] : 0;
+		items[m++].index = i;
+	}
+	qsort(items, m, sizeof(*items), m_sched_item_cmp);
+
+	/* Longest test to the less loaded worker */
+	for (i = 0; i < m; ++i) {
+		unsigned int min = 0;
+
+		for (w = 1; w < pool->worker_count; ++w)
+			if (load[w] < load[min])
+				min = w;
+		load[min] += items[i].est;
+		owner[i] = min;
+		pool->deques[min].tail++;
+	}
+
+	/* Lay out the queues one after the other, preserving the order */
+	for (w = 0, sum = 0; w < pool->worker_count; ++w) {
+		pool->deques[w].head = sum;
+		sum += pool->deques[w].tail;
+		pool->deques[w].tail = pool->deques[w].head;
+	}
+	for (i = 0; i < m; ++i)
+		pool->slots[pool->deques[owner[i]].tail++] = items[i].index;
+
+	free(est);
+	free(items);
+	free(owner);
+	free(load);
+	return 0;
+
+err:
+	free(est);
+	free(items);
+	free(owner);
+	free(load);
+	return -1;
+}
+
+
+/* -------------------------------------------------------------------- */
+/*                             Result Cache                             */
+/* -------------------------------------------------------------------- */
+
+/*
+ * A cache line is "<suite hash> <test index> <desc hash> <code hash>".
+ * The code hash covers the object (program or shared object) that
+ * contains the test function and the mamma library itself: when any of
+ * them is rebuilt with changes, the cached results are not valid anymore
+ */
+
+/**
+ * Code object being looked up by m_code_hash_cb()
+ */
+struct m_code {
+	uintptr_t addr; /**< address within the object */
+	uintptr_t lo; /**< lowest address of the object */
+	uintptr_t hi; /**< one past the highest address of the object */
+	uint64_t hash; /**< object hash */
+	int found; /**< the object has been found */
+};
+
+static uint64_t m_hash_mem(uint64_t h, const void *mem, size_t len)
+{
+	const unsigned char *p = mem;
+
+	while (len--) {
+		h ^= *p++;
+		h *= 0x100000001b3ULL;
+	}
+
+	return h;
+}
+
+/**
+ * It hashes the object that contains the given address: its GNU
+ * build-id when available, otherwise its read-only segments (text and
+ * rodata)
+ */
+static int m_code_hash_cb(struct dl_phdr_info *info, size_t size, void *data)
+{
+	struct m_code *code = data;
+	uint64_t h = 0xcbf29ce484222325ULL;
+	unsigned int i;
+
+	for (i = 0; i < info->dlpi_phnum; ++i) {
+		const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+		uintptr_t start = info->dlpi_addr + ph->p_vaddr;
+
+		if (ph->p_type == PT_LOAD && code->addr >= start &&
+		    code->addr < start + ph->p_memsz)
+			break;
+	}
+	if (i == info->dlpi_phnum)
+		return 0; /* Not this object */
+
+	code->found = 1;
+	code->lo = UINTPTR_MAX;
+	code->hi = 0;
+	for (i = 0; i < info->dlpi_phnum; ++i) {
+		const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+		uintptr_t start = info->dlpi_addr + ph->p_vaddr;
+
+		if (ph->p_type != PT_LOAD)
+			continue;
+		if (start < code->lo)
+			code->lo = start;
+		if (start + ph->p_memsz > code->hi)
+			code->hi = start + ph->p_memsz;
+	}
+	for (i = 0; i < info->dlpi_phnum; ++i) {
+		const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+		const char *note = (const char *)(info->dlpi_addr + ph->p_vaddr);
+		const char *end = note + ph->p_memsz;
+
+		if (ph->p_type != PT_NOTE)
+			continue;
+		while (note + sizeof(ElfW(Nhdr)) <= end) {
+			const ElfW(Nhdr) *nh = (const ElfW(Nhdr) *)note;
+			const char *name = note + sizeof(*nh);
+			const char *desc = name + ((nh->n_namesz + 3) & ~3);
+
+			if (nh->n_type == NT_GNU_BUILD_ID &&
+			    nh->n_namesz == 4 && !memcmp(name, "GNU", 4)) {
+				code->hash = m_hash_mem(h, desc, nh->n_descsz);
+				return 1;
+			}
+			note = desc + ((nh->n_descsz + 3) & ~3);
+		}
+	}
+
+	for (i = 0; i < info->dlpi_phnum; ++i) {
+		const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+
+		if (ph->p_type == PT_LOAD && !(ph->p_flags & PF_W))
+			h = m_hash_mem(h, (const void *)(info->dlpi_addr +
+							 ph->p_vaddr),
+				       ph->p_memsz);
+	}
+	code->hash = h;
+
+	return 1;
+}
+
+/**
+ * It returns the hash of the object that contains the given address
+ * @param[in] addr address within the object
+ * @param[in,out] memo last object hashed, it avoids hashing the same
+ *                object again
+ * @return the object hash, 0 if not found
+ */
+static uint64_t m_code_hash(uintptr_t addr, struct m_code *memo)
+{
+	if (memo->found && addr >= memo->lo && addr < memo->hi)
+		return memo->hash;
+
+	memset(memo, 0, sizeof(*memo));
+	memo->addr = addr;
+	dl_iterate_phdr(m_code_hash_cb, memo);
+
+	return memo->hash;
+}
+
+/**
+ * It returns the hash of the code the test depends on
+ * @param[in] m_test the test
+ * @param[in,out] memo objects hashed so far (the library and the last
+ *                test object), zeroed before the first call
+ * @return the test code hash
+ */
+static uint64_t m_cache_key(struct m_test *m_test, struct m_code memo[2])
+{
+	uint64_t lib, code;
+
+	lib = m_code_hash((uintptr_t)m_suite_run, &memo[0]);
+	code = m_code_hash((uintptr_t)m_test->test, &memo[1]);
+
+	return m_hash_mem(lib, &code, sizeof(code));
+}
+
+/**
+ * It reads the cached code hash of each suite's test
+ * @param[in] m_suite the suite
+ * @param[out] keys code hash of each test, 0 if not cached
+ */
+static void m_cache_read(struct m_suite *m_suite, uint64_t *keys)
+{
+	uint64_t suite_key, desc_key, key;
+	unsigned int index;
+	char line[128];
+	FILE *f;
+
+	f = fopen(m_suite->cache, "r");
+	if (!f)
+		return;
+
+	suite_key = m_hash_str(m_suite->name);
+	while (fgets(line, sizeof(line), f)) {
+		uint64_t skey;
+
+		if (sscanf(line, "%" SCNx64 " %u %" SCNx64 " %" SCNx64,
+			   &skey, &index, &desc_key, &key) != 4)
+			continue;
+		if (skey != suite_key || index >= m_suite->test_count)
+			continue;
+		if (desc_key != m_hash_str(m_suite->tests[index].desc))
+			continue; /* the test changed */
+		keys[index] = key;
+	}
+	fclose(f);
+}
+
+/**
+ * It marks as cached the tests that succeeded with the same code.
+ * Benchmarks always run
+ * @param[in] m_suite the suite
+ */
+static void m_cache_load(struct m_suite *m_suite)
+{
+	struct m_code memo[2];
+	uint64_t *keys;
+	unsigned int i;
+
+	if (m_suite->flags & M_CACHE_FORCE)
+		return;
+	keys = calloc(m_suite->test_count, sizeof(*keys));
+	if (!keys)
+		return;
+	m_cache_read(m_suite, keys);
+
+	memset(memo, 0, sizeof(memo));
+	for (i = 0; i < m_suite->test_count; ++i) {
+		struct m_test *m_test = &m_suite->tests[i];
+
+		if (!keys[i] || !m_test->test ||
+		    (m_test->flags & (M_TEST_DISABLED | M_TEST_BENCH)) ||
+		    keys[i] != m_cache_key(m_test, memo))
+			continue;
+		m_test->exit = M_STATE_EXIT_CACHED;
+		m_count_inc(m_suite->cached_count);
+		m_count_inc(m_suite->total_count);
+	}
+
+	free(keys);
+}
+
+/**
+ * It updates the cache with the tests that succeeded. Tests that did not
+ * run keep their previous entry
+ * @param[in] m_suite the suite
+ */
+static void m_cache_save(struct m_suite *m_suite)
+{
+	uint64_t suite_key = m_hash_str(m_suite->name);
+	struct m_code memo[2];
+	uint64_t *keys;
+	char tmp[4096];
+	unsigned int i;
+	FILE *out;
+
+	keys = calloc(m_suite->test_count, sizeof(*keys));
+	if (!keys)
+		return;
+	m_cache_read(m_suite, keys);
+
+	out = m_datafile_rewrite(m_suite->cache, suite_key, tmp, sizeof(tmp));
+	if (!out)
+		goto out;
+
+	memset(memo, 0, sizeof(memo));
+	for (i = 0; i < m_suite->test_count; ++i) {
+		struct m_test *m_test = &m_suite->tests[i];
+
+		switch (m_test->exit) {
+		case M_STATE_EXIT_SUCCESS:
+			if (!m_test->test || (m_test->flags & M_TEST_BENCH))
+				continue;
+			keys[i] = m_cache_key(m_test, memo);
+			break;
+		case M_STATE_EXIT_NORUN:
+		case M_STATE_EXIT_CACHED:
+			break;
+		default:
+			continue;
+		}
+		if (!keys[i])
+			continue;
+		fprintf(out, "%016" PRIx64 " %u %016" PRIx64 " %016" PRIx64 "\n",
+			suite_key, i, m_hash_str(m_test->desc), keys[i]);
+	}
+
+	m_datafile_commit(out, tmp, m_suite->cache);
+out:
+	free(keys);
+}
+
+
+/* -------------------------------------------------------------------- */
+/*                          Last Run Ordering                           */
+/* -------------------------------------------------------------------- */
+
+/*
+ * A last run line is
+ * "<suite hash> <test index> <desc hash> <code hash> <exit cause>"
+ */
+
+/**
+ * It reads the results of the last run
+ * @param[in] m_suite the suite
+ * @param[out] keys code hash of each test, 0 if the test is new
+ * @param[out] exits exit cause of each test
+ */
+static void m_last_run_read(struct m_suite *m_suite, uint64_t *keys,
+			    unsigned int *exits)
+{
+	uint64_t suite_key, desc_key, key;
+	unsigned int index, exit;
+	char line[128];
+	FILE *f;
+
+	f = fopen(m_suite->last_run, "r");
+	if (!f)
+		return;
+
+	suite_key = m_hash_str(m_suite->name);
+	while (fgets(line, sizeof(line), f)) {
+		uint64_t skey;
+
+		if (sscanf(line, "%" SCNx64 " %u %" SCNx64 " %" SCNx64 " %u",
+			   &skey, &index, &desc_key, &key, &exit) != 5)
+			continue;
+		if (skey != suite_key || index >= m_suite->test_count)
+			continue;
+		if (desc_key != m_hash_str(m_suite->tests[index].desc))
+			continue; /* the test changed */
+		keys[index] = key;
+		exits[index] = exit;
+	}
+	fclose(f);
+}
+
+/**
+ * It sets the run order of the suite: the tests that failed in the last
+ * run come first, then the new and changed ones, then all the others.
+ * Within each group tests keep the index order
+ * @param[in] m_suite the suite
+ */
+static void m_last_run_order(struct m_suite *m_suite)
+{
+	unsigned int i, p, n = m_suite->test_count, *exits;
+	struct m_code memo[2];
+	uint64_t *keys;
+
+	keys = calloc(n, sizeof(*keys));
+	exits = calloc(n, sizeof(*exits));
+	status->prio = calloc(n, sizeof(*status->prio));
+	status->order = calloc(n, sizeof(*status->order));
+	if (!keys || !exits || !status->prio || !status->order) {
+		free(status->prio);
+		free(status->order);
+		status->prio = NULL;
+		status->order = NULL;
+		goto out;
+	}
+	m_last_run_read(m_suite, keys, exits);
+
+	memset(memo, 0, sizeof(memo));
+	for (i = 0; i < n; ++i) {
+		struct m_test *m_test = &m_suite->tests[i];
+
+		if (!m_test_runnable(m_test))
+			continue;
+		if (exits[i] == M_STATE_EXIT_ERROR ||
+		    exits[i] == M_STATE_EXIT_TIMEOUT ||
+		    exits[i] == M_STATE_EXIT_REGRESSION)
+			status->prio[i] = 2;
+		else if (!keys[i] || keys[i] != m_cache_key(m_test, memo))
+			status->prio[i] = 1;
+	}
+
+	for (p = 3, n = 0; p--; )
+		for (i = 0; i < m_suite->test_count; ++i)
+			if (status->prio[i] == p)
+				status->order[n++] = i;
+out:
+	free(keys);
+	free(exits);
+}
+
+/**
+ * It records the results of the run. Tests that did not run keep their
+ * previous result
+ * @param[in] m_suite the suite
+ */
+static void m_last_run_save(struct m_suite *m_suite)
+{
+	uint64_t suite_key = m_hash_str(m_suite->name);
+	unsigned int i, *exits;
+	struct m_code memo[2];
+	uint64_t *keys;
+	char tmp[4096];
+	FILE *out;
+
+	keys = calloc(m_suite->test_count, sizeof(*keys));
+	exits = calloc(m_suite->test_count, sizeof(*exits));
+	if (!keys || !exits)
+		goto out;
+	m_last_run_read(m_suite, keys, exits);
+
+	out = m_datafile_rewrite(m_suite->last_run, suite_key,
+				 tmp, sizeof(tmp));
+	if (!out)
+		goto out;
+
+	memset(memo, 0, sizeof(memo));
+	for (i = 0; i < m_suite->test_count; ++i) {
+		struct m_test *m_test = &m_suite->tests[i];
+
+		if (m_test->exit != M_STATE_EXIT_NORUN && m_test->test) {
+			keys[i] = m_cache_key(m_test, memo);
+			exits[i] = m_test->exit == M_STATE_EXIT_CACHED ?
+				   M_STATE_EXIT_SUCCESS : m_test->exit;
+		}
+		if (!keys[i])
+			continue;
+		fprintf(out, "%016" PRIx64 " %u %016" PRIx64 " %016" PRIx64 " %u\n",
+			suite_key, i, m_hash_str(m_test->desc), keys[i],
+			exits[i]);
+	}
+
+	m_datafile_commit(out, tmp, m_suite->last_run);
+out:
+	free(keys);
+	free(exits);
+}
+
+
+/* -------------------------------------------------------------------- */
+/*                         Parallel Worker Pool                         */
+/* -------------------------------------------------------------------- */
+
+/**
+ * It gets the number of tests an isolated child runs before it is
+ * replaced
+ * @param[in] m_suite the M_ISOLATE suite
+ * @return the number of tests, 0 for no limit
+ */
+static unsigned int m_isolate_batch(struct m_suite *m_suite)
+{
+	if (m_suite->isolate_batch == M_ISOLATE_BATCH_ALL)
+		return 0;
+	return m_suite->isolate_batch ? m_suite->isolate_batch : 1;
+}
+
+/**
+ * It allocates a worker pool in a shared memory mapping
+ * @param[in] m_suite the suite to distribute among workers
+ * @param[in] nworkers number of workers
+ * @return a worker pool, NULL on error
+ */
+static struct m_pool *m_pool_create(struct m_suite *m_suite,
+				    unsigned int nworkers)
+{
+	struct m_pool *pool;
+	size_t size;
+	void *mem;
+
+	size = sizeof(*pool);
+	size += m_suite->test_count * (sizeof(*pool->results) +
+				       sizeof(*pool->slots));
+	size += nworkers * (sizeof(*pool->arenas) + sizeof(*pool->pids) +
+			    sizeof(*pool->pidfds) + sizeof(*pool->current) +
+			    sizeof(*pool->deques));
+	size += nworkers * m_output_max(m_suite);
+
+	/* Arena pages are backed only when a test writes there */
+	mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (mem == MAP_FAILED)
+		return NULL;
+
+	pool = mem;
+	pool->size = size;
+	pool->test_count = m_suite->test_count;
+	pool->worker_count = nworkers;
+	pool->batch = 0;
+	if (m_suite->flags & M_ISOLATE)
+		pool->batch = m_isolate_batch(m_suite);
+	pool->budget = m_fail_budget(m_suite);
+	pool->output_max = m_output_max(m_suite);
+	pool->results = (struct m_result *)(pool + 1);
+	pool->arenas = (struct m_arena *)(pool->results + m_suite->test_count);
+	pool->pids = (pid_t *)(pool->arenas + nworkers);
+	pool->pidfds = (int *)(pool->pids + nworkers);
+	pool->current = pool->pidfds + nworkers;
+	pool->deques = (struct m_deque *)(pool->current + nworkers);
+	pool->slots = (unsigned int *)(pool->deques + nworkers);
+	pool->output = (char *)(pool->slots + m_suite->test_count);
+
+	return pool;
+}
+
+/**
+ * It releases a worker pool
+ * @param[in] pool worker pool to release
+ */
+static void m_pool_destroy(struct m_pool *pool)
+{
+	munmap(pool, pool->size);
+}
+
+static void m_deque_lock(struct m_deque *dq)
+{
+	while (__atomic_exchange_n(&dq->lock, 1, __ATOMIC_ACQUIRE))
+		sched_yield();
+}
+
+static void m_deque_unlock(struct m_deque *dq)
+{
+	__atomic_store_n(&dq->lock, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * It takes a test from a worker queue
+ * @param[in] dq the worker queue
+ * @param[in] steal take the test from the tail instead of the head
+ * @return a test index, -1 when the queue is empty
+ */
+static int m_deque_take(struct m_deque *dq, int steal)
+{
+	int index = -1;
+
+	m_deque_lock(dq);
+	if (dq->head < dq->tail)
+		index = status->pool->slots[steal ? --dq->tail : dq->head++];
+	m_deque_unlock(dq);
+
+	return index;
+}
+
+static unsigned int m_deque_len(struct m_deque *dq)
+{
+	unsigned int head = __atomic_load_n(&dq->head, __ATOMIC_RELAXED);
+	unsigned int tail = __atomic_load_n(&dq->tail, __ATOMIC_RELAXED);
+
+	return tail > head ? tail - head : 0;
+}
+
+/**
+ * It tells if there are tests still waiting in any queue
+ * @return the number of tests still waiting
+ */
+static unsigned int m_pool_pending(void)
+{
+	unsigned int i, n = 0;
+
+	for (i = 0; i < status->pool->worker_count; ++i)
+		n += m_deque_len(&status->pool->deques[i]);
+
+	return n;
+}
+
+/**
+ * It hands out the next test to run. A worker runs the tests in its own
+ * queue, longest first; once its queue is empty it steals from the
+ * worker with most tests still waiting
+ * @return the next test to run, NULL when there are no more tests
+ */
+static struct m_test *m_pool_next(void)
+{
+	struct m_pool *pool = status->pool;
+	int index;
+
+	index = m_deque_take(&pool->deques[status->worker], 0);
+	while (index < 0) {
+		unsigned int i, len, victim = 0, max = 0;
+
+		for (i = 0; i < pool->worker_count; ++i) {
+			len = m_deque_len(&pool->deques[i]);
+			if (len > max) {
+				max = len;
+				victim = i;
+			}
+		}
+		if (!max)
+			break;
+		index = m_deque_take(&pool->deques[victim], 1);
+	}
+
+	if (index < 0) {
+		pool->current[status->worker] = -1;
+		return NULL;
+	}
+
+	return &status->m_suite_cur->tests[index];
+}
+
+/**
+ * It cancels the run: the tests still waiting are dropped and the
+ * running ones are stopped (their tear_down() runs). Cancelled tests do
+ * not count as run. It is called by workers and by the parent
+ */
+static void m_pool_cancel(void)
+{
+	struct m_pool *pool = status->pool;
+	pid_t self = getpid();
+	unsigned int i;
+
+	for (i = 0; i < pool->worker_count; ++i) {
+		m_deque_lock(&pool->deques[i]);
+		pool->deques[i].tail = pool->deques[i].head;
+		m_deque_unlock(&pool->deques[i]);
+	}
+	for (i = 0; i < pool->worker_count; ++i)
+		if (pool->pids[i] && pool->pids[i] != self &&
+		    __atomic_load_n(&pool->current[i], __ATOMIC_RELAXED) >= 0)
+			kill(pool->pids[i], M_CANCEL_SIGNAL);
+}
+
+/**
+ * It accounts a failed test in the failure budget, and it cancels the
+ * run when the budget is exhausted
+ */
+static void m_pool_failed(void)
+{
+	if (status->pool->budget &&
+	    __atomic_add_fetch(&status->pool->failures, 1, __ATOMIC_RELAXED) ==
+	    status->pool->budget)
+		m_pool_cancel();
+}
+
+/**
+ * It makes the test result visible to the parent process
+ * @param[in] m_test the test that just completed
+ */
+static void m_pool_publish(struct m_test *m_test)
+{
+	struct m_result *res = &status->pool->results[m_test->index];
+
+	res->warnings = m_test->warnings;
+	res->time_set_up = m_test->time_set_up;
+	res->time_test = m_test->time_test;
+	res->time_tear_down = m_test->time_tear_down;
+	res->bench = m_test->bench;
+	res->perf = m_test->perf;
+	__atomic_store_n(&res->exit, m_test->exit, __ATOMIC_RELEASE);
+	status->pool->current[status->worker] = -1;
+
+	if (m_test_failed(m_test))
+		m_pool_failed();
+
+	/* Keep test messages together when stdout is not a terminal */
+	fflush(stdout);
+}
+
+/**
+ * Worker main loop. It never returns.
+ * @param[in] worker worker identifier
+ */
+static void m_pool_worker(unsigned int worker)
+{
+	status->worker = worker;
+	/* Timers are not inherited by fork() */
+	status->timer_state = 0;
+	status->m_test_cur = m_pool_next();
+	if (status->m_test_cur)
+		m_suite_run_state_machine(status->m_suite_cur,
+					  M_STATE_TEST_SET_UP);
+	fflush(stdout);
+	_exit(0);
+}
+
+/**
+ * It starts a new worker
+ * @param[in] worker worker identifier
+ * @return 0 on success, -1 on error
+ */
+static int m_pool_spawn(unsigned int worker)
+{
+	pid_t pid;
+
+	/* Do not let workers inherit (and print again) pending output */
+	fflush(stdout);
+	status->pool->current[worker] = -1;
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (pid == 0)
+		m_pool_worker(worker);
+	status->pool->pids[worker] = pid;
+#ifdef SYS_pidfd_open
+	status->pool->pidfds[worker] = syscall(SYS_pidfd_open, pid, 0);
+#else
+	status->pool->pidfds[worker] = -1;
+#endif
+
+	return 0;
+}
+
+/**
+ * It waits for the termination of any worker of the pool.
+ * Other threads may run their own pools (or spawn their own processes),
+ * so whenever possible we wait only for our workers by polling their
+ * process file descriptors. On older kernels, fall back to waitpid(-1)
+ * @param[out] wstatus worker termination status
+ * @return the terminated worker identifier, -1 on error
+ */
+static int m_pool_wait(int *wstatus)
+{
+	struct m_pool *pool = status->pool;
+	struct pollfd pfd[pool->worker_count];
+	unsigned int i, n = 0, map[pool->worker_count];
+	pid_t pid;
+
+	for (i = 0; i < pool->worker_count; ++i) {
+		if (!pool->pids[i])
+			continue;
+		if (pool->pidfds[i] < 0)
+			break;
+		pfd[n].fd = pool->pidfds[i];
+		pfd[n].events = POLLIN;
+		map[n++] = i;
+	}
+
+	if (i == pool->worker_count) {
+		while (poll(pfd, n, -1) < 0)
+			if (errno != EINTR)
+				return -1;
+		for (i = 0; i < n; ++i) {
+			if (!pfd[i].revents)
+				continue;
+			close(pfd[i].fd);
+			pool->pidfds[map[i]] = -1;
+			while (waitpid(pool->pids[map[i]], wstatus, 0) < 0)
+				if (errno != EINTR)
+					return -1;
+			return map[i];
+		}
+		return -1;
+	}
+
+	do {
+		pid = waitpid(-1, wstatus, 0);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		for (i = 0; i < pool->worker_count; ++i)
+			if (pool->pids[i] == pid)
+				return i;
+	} while (1);
+}
+
+/**
+ * It handles the termination of a worker. If the worker died while running
+ * a test, that test is marked as failed. A new worker replaces the
+ * terminated one as long as there are tests waiting
+ * @param[in] worker worker identifier
+ * @param[in] wstatus worker termination status as returned by waitpid()
+ * @return 1 when the worker has been replaced, 0 otherwise
+ */
+static int m_pool_reap(unsigned int worker, int wstatus)
+{
+	struct m_pool *pool = status->pool;
+	struct m_arena *a = &pool->arenas[worker];
+	int index = pool->current[worker];
+
+	pool->pids[worker] = 0;
+	/* The messages of the test the worker died in come before its fate */
+	if (a->len || a->dropped) {
+		fflush(stdout);
+		m_out_arena_write(a, pool->output + worker * pool->output_max);
+	}
+	if (index >= 0 && WIFSIGNALED(wstatus)) {
+		fprintf(stdout, "ERROR @ worker %u - test %d killed by %s (%s)\n",
+			worker, index, m_signal_name(WTERMSIG(wstatus)),
+			strsignal(WTERMSIG(wstatus)));
+		pool->results[index].exit = M_STATE_EXIT_ERROR;
+	} else if (index >= 0) {
+		fprintf(stdout, "ERROR @ worker %u - test %d exited with status %d\n",
+			worker, index, WEXITSTATUS(wstatus));
+		pool->results[index].exit = M_STATE_EXIT_ERROR;
+	}
+	if (index >= 0)
+		m_pool_failed();
+
+	if (!m_pool_pending())
+		return 0;
+
+	return m_pool_spawn(worker) == 0;
+}
+
+/**
+ * It accounts the results published by the workers into the suite
+ */
+static void m_pool_collect(void)
+{
+	struct m_suite *suite = status->m_suite_cur;
+	unsigned int i;
+
+	for (i = 0; i < suite->test_count; ++i) {
+		struct m_test *m_test = &suite->tests[i];
+		struct m_result *res = &status->pool->results[i];
+
+		if (res->exit == M_STATE_EXIT_NORUN)
+			continue; /* disabled, cached or lost */
+		m_test->exit = res->exit;
+		m_test->warnings = res->warnings;
+		m_test->time_set_up = res->time_set_up;
+		m_test->time_test = res->time_test;
+		m_test->time_tear_down = res->time_tear_down;
+		m_test->bench = res->bench;
+		m_test->perf = res->perf;
+		switch (m_test->exit) {
+		case M_STATE_EXIT_NORUN:
+		case M_STATE_EXIT_CACHED:
+			continue;
+		case M_STATE_EXIT_SUCCESS:
+			m_count_inc(suite->success_count);
+			break;
+		case M_STATE_EXIT_SKIP:
+			m_count_inc(suite->skip_count);
+			break;
+		case M_STATE_EXIT_ERROR:
+			m_count_inc(suite->fail_count);
+			break;
+		case M_STATE_EXIT_REGRESSION:
+			m_count_inc(suite->regression_count);
+			break;
+		case M_STATE_EXIT_TIMEOUT:
+			m_count_inc(suite->timeout_count);
+			break;
+		}
+		m_count_inc(suite->total_count);
+	}
+}
+
+/**
+ * It runs all the suite's tests in the worker pool and it waits for
+ * their completion
+ */
+static void m_pool_run(void)
+{
+	struct m_pool *pool = status->pool;
+	unsigned int i, alive = 0;
+
+	for (i = 0; i < pool->worker_count; ++i)
+		alive += (m_pool_spawn(i) == 0);
+
+	while (alive) {
+		int wstatus, worker;
+
+		worker = m_pool_wait(&wstatus);
+		if (worker < 0)
+			break;
+		if (!m_pool_reap(worker, wstatus))
+			alive--;
+	}
+
+	m_pool_collect();
+}
+
+
+/* -------------------------------------------------------------------- */
+/*                       Array and Memory Comparison                    */
+/* -------------------------------------------------------------------- */
+
+/*
+ * The array kernels look for the first failing element: the vector loops
+ * stop at the first block that contains one and the scalar loop finds it
+ * (and it processes the tail). The failure analysis (count, maximum
+ * error) is done only when something failed.
+ */
+
+static size_t m_array_int_eq_scalar(const int *exp, const int *val,
+				    size_t n, size_t i)
+{
+	for (; i < n; ++i)
+		if (exp[i] != val[i])
+			return i;
+	return n;
+}
+
+static size_t m_array_int_range_scalar(int min, int max, const int *val,
+				       size_t n, size_t i)
+{
+	for (; i < n; ++i)
+		if (val[i] < min || val[i] > max)
+			return i;
+	return n;
+}
+
+static size_t m_array_int_sorted_scalar(const int *val, size_t n, size_t i)
+{
+	for (; i + 1 < n; ++i)
+		if (val[i] > val[i + 1])
+			return i + 1;
+	return n;
+}
+
+static int m_array_dbl_near_one(double exp, double val,
+				double abs_tol, double rel_tol)
+{
+	return exp == val || fabs(exp - val) <= fmax(abs_tol, rel_tol * fabs(exp));
+}
+
+static size_t m_array_dbl_near_scalar(const double *exp, const double *val,
+				      size_t n, double abs_tol,
+				      double rel_tol, size_t i)
+{
+	for (; i < n; ++i)
+		if (!m_array_dbl_near_one(exp[i], val[i], abs_tol, rel_tol))
+			return i;
+	return n;
+}
+
+/**
+ * Memory comparisons are summarized per block of this size (bytes)
+ */
+#define M_MEM_BLOCK 64
+
+/**
+ * Differences between two memory areas
+ */
+struct m_mem_diff {
+	size_t first; /**< offset of the first difference, the size if none */
+	size_t bytes; /**< number of differing bytes */
+	size_t blocks; /**< number of M_MEM_BLOCK blocks with differences */
+};
+
+/**
+ * It accounts the differences of a block
+ * @param[in] d differences found so far
+ * @param[in] offset block offset
+ * @param[in] mask one bit per differing byte of the block
+ */
+static void m_mem_diff_block(struct m_mem_diff *d, size_t offset,
+			     uint64_t mask)
+{
+	if (!mask)
+		return;
+	if (!d->bytes)
+		d->first = offset + __builtin_ctzll(mask);
+	d->bytes += __builtin_popcountll(mask);
+	d->blocks++;
+}
+
+static void m_mem_diff_scalar(const unsigned char *a, const unsigned char *b,
+			      size_t n, size_t i, struct m_mem_diff *d)
+{
+	for (; i < n; i += M_MEM_BLOCK) {
+		size_t j, len = n - i < M_MEM_BLOCK ? n - i : M_MEM_BLOCK;
+		uint64_t mask = 0;
+
+		for (j = 0; j < len; ++j)
+			mask |= (uint64_t)(a[i + j] != b[i + j]) << j;
+		m_mem_diff_block(d, i, mask);
+	}
+}
+
+/**
+ * It tells if reading the given number of bytes crosses a page boundary.
+ * Strings may end right before an unmapped page: vector loads past their
+ * end are safe only within the page of the terminator
+ */
+#define m_page_cross(_ptr, _len) \
+	(((uintptr_t)(_ptr) & 4095) > 4096 - (_len))
+
+static size_t m_str_diff_scalar(const char *a, const char *b, size_t n,
+				size_t i, size_t end)
+{
+	for (; i < end; ++i)
+		if (a[i] != b[i] || !a[i])
+			return i;
+	return n;
+}
+
+/**
+ * Array kernels for a given instruction set. Each one returns the index
+ * of the first failing element, or the number of elements. The memory
+ * kernel accounts all the differences, in a single pass. The string
+ * kernel returns the position where two strings differ or end (both),
+ * or the maximum length
+ */
+struct m_array_ops {
+	const char *name; /**< instruction set */
+	size_t (*int_eq)(const int *exp, const int *val, size_t n);
+	size_t (*int_range)(int min, int max, const int *val, size_t n);
+	size_t (*int_sorted)(const int *val, size_t n);
+	size_t (*dbl_near)(const double *exp, const double *val, size_t n,
+			   double abs_tol, double rel_tol);
+	void (*mem_diff)(const unsigned char *a, const unsigned char *b,
+			 size_t n, struct m_mem_diff *d);
+	size_t (*str_diff)(const char *a, const char *b, size_t n);
+};
+
+static size_t m_array_int_eq_none(const int *exp, const int *val, size_t n)
+{
+	return m_array_int_eq_scalar(exp, val, n, 0);
+}
+
+static size_t m_array_int_range_none(int min, int max, const int *val,
+				     size_t n)
+{
+	return m_array_int_range_scalar(min, max, val, n, 0);
+}
+
+static size_t m_array_int_sorted_none(const int *val, size_t n)
+{
+	return m_array_int_sorted_scalar(val, n, 0);
+}
+
+static size_t m_array_dbl_near_none(const double *exp, const double *val,
+				    size_t n, double abs_tol, double rel_tol)
+{
+	return m_array_dbl_near_scalar(exp, val, n, abs_tol, rel_tol, 0);
+}
+
+static void m_mem_diff_none(const unsigned char *a, const unsigned char *b,
+			    size_t n, struct m_mem_diff *d)
+{
+	m_mem_diff_scalar(a, b, n, 0, d);
+}
+
+static size_t m_str_diff_none(const char *a, const char *b, size_t n)
+{
+	return m_str_diff_scalar(a, b, n, 0, n);
+}
+
+static const struct m_array_ops m_array_scalar = {
+	.name = "scalar",
+	.int_eq = m_array_int_eq_none,
+	.int_range = m_array_int_range_none,
+	.int_sorted = m_array_int_sorted_none,
+	.dbl_near = m_array_dbl_near_none,
+	.mem_diff = m_mem_diff_none,
+	.str_diff = m_str_diff_none,
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+#define M_ARRAY_X86
+#include <immintrin.h>
+
+#define M_SSE2 __attribute__((target("sse2")))
+#define M_AVX2 __attribute__((target("avx2")))
+#define M_AVX512 __attribute__((target("avx512f,avx512bw")))
+/* String kernels read past the terminator, within its page */
+#define M_NO_ASAN __attribute__((no_sanitize_address))
+
+static M_SSE2 size_t m_array_int_eq_sse2(const int *exp, const int *val,
+					 size_t n)
+{
+	size_t i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m128i e = _mm_loadu_si128((const __m128i *)(exp + i));
+		__m128i v = _mm_loadu_si128((const __m128i *)(val + i));
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(e, v)) != 0xFFFF)
+			break;
+	}
+	return m_array_int_eq_scalar(exp, val, n, i);
+}
+
+static M_SSE2 size_t m_array_int_range_sse2(int min, int max,
+					    const int *val, size_t n)
+{
+	__m128i lo = _mm_set1_epi32(min), hi = _mm_set1_epi32(max);
+	size_t i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(val + i));
+		__m128i out = _mm_or_si128(_mm_cmplt_epi32(v, lo),
+					   _mm_cmpgt_epi32(v, hi));
+
+		if (_mm_movemask_epi8(out))
+			break;
+	}
+	return m_array_int_range_scalar(min, max, val, n, i);
+}
+
+static M_SSE2 size_t m_array_int_sorted_sse2(const int *val, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i + 4 < n; i += 4) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(val + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(val + i + 1));
+
+		if (_mm_movemask_epi8(_mm_cmpgt_epi32(a, b)))
+			break;
+	}
+	return m_array_int_sorted_scalar(val, n, i);
+}
+
+static M_SSE2 size_t m_array_dbl_near_sse2(const double *exp,
+					   const double *val, size_t n,
+					   double abs_tol, double rel_tol)
+{
+	__m128d sign = _mm_set1_pd(-0.0);
+	__m128d at = _mm_set1_pd(abs_tol), rt = _mm_set1_pd(rel_tol);
+	size_t i;
+
+	for (i = 0; i + 2 <= n; i += 2) {
+		__m128d e = _mm_loadu_pd(exp + i);
+		__m128d v = _mm_loadu_pd(val + i);
+		__m128d err = _mm_andnot_pd(sign, _mm_sub_pd(e, v));
+		__m128d tol = _mm_max_pd(at, _mm_mul_pd(rt,
+						_mm_andnot_pd(sign, e)));
+		__m128d ok = _mm_or_pd(_mm_cmpeq_pd(e, v),
+				       _mm_cmple_pd(err, tol));
+
+		if (_mm_movemask_pd(ok) != 0x3)
+			break;
+	}
+	return m_array_dbl_near_scalar(exp, val, n, abs_tol, rel_tol, i);
+}
+
+static M_SSE2 void m_mem_diff_sse2(const unsigned char *a,
+				   const unsigned char *b, size_t n,
+				   struct m_mem_diff *d)
+{
+	size_t i, j;
+
+	for (i = 0; i + M_MEM_BLOCK <= n; i += M_MEM_BLOCK) {
+		uint64_t mask = 0;
+
+		for (j = 0; j < M_MEM_BLOCK; j += 16) {
+			__m128i x = _mm_loadu_si128((const __m128i *)(a + i + j));
+			__m128i y = _mm_loadu_si128((const __m128i *)(b + i + j));
+			unsigned int eq = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+
+			mask |= (uint64_t)(~eq & 0xFFFF) << j;
+		}
+		m_mem_diff_block(d, i, mask);
+	}
+	m_mem_diff_scalar(a, b, n, i, d);
+}
+
+static M_SSE2 M_NO_ASAN size_t m_str_diff_sse2(const char *a, const char *b,
+					       size_t n)
+{
+	__m128i x, y, zero = _mm_setzero_si128();
+	unsigned int stop;
+	size_t i = 0;
+
+	while (i < n) {
+		if (n - i < 16 || m_page_cross(a + i, 16) ||
+		    m_page_cross(b + i, 16)) {
+			size_t end = n - i < 16 ? n : i + 16;
+			size_t pos = m_str_diff_scalar(a, b, n, i, end);
+
+			if (pos < n)
+				return pos;
+			i = end;
+			continue;
+		}
+		x = _mm_loadu_si128((const __m128i *)(a + i));
+		y = _mm_loadu_si128((const __m128i *)(b + i));
+		stop = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) |
+			_mm_movemask_epi8(_mm_cmpeq_epi8(x, zero));
+		stop &= 0xFFFF;
+		if (stop)
+			return i + __builtin_ctz(stop);
+		i += 16;
+	}
+	return n;
+}
+
+static M_AVX2 size_t m_array_int_eq_avx2(const int *exp, const int *val,
+					 size_t n)
+{
+	size_t i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m256i e = _mm256_loadu_si256((const __m256i *)(exp + i));
+		__m256i v = _mm256_loadu_si256((const __m256i *)(val + i));
+
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(e, v)) != -1)
+			break;
+	}
+	return m_array_int_eq_scalar(exp, val, n, i);
+}
+
+static M_AVX2 size_t m_array_int_range_avx2(int min, int max,
+					    const int *val, size_t n)
+{
+	__m256i lo = _mm256_set1_epi32(min), hi = _mm256_set1_epi32(max);
+	size_t i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(val + i));
+		__m256i out = _mm256_or_si256(_mm256_cmpgt_epi32(lo, v),
+					      _mm256_cmpgt_epi32(v, hi));
+
+		if (_mm256_movemask_epi8(out))
+			break;
+	}
+	return m_array_int_range_scalar(min, max, val, n, i);
+}
+
+static M_AVX2 size_t m_array_int_sorted_avx2(const int *val, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i + 8 < n; i += 8) {
+		__m256i a = _mm256_loadu_si256((const __m256i *)(val + i));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(val + i + 1));
+
+		if (_mm256_movemask_epi8(_mm256_cmpgt_epi32(a, b)))
+			break;
+	}
+	return m_array_int_sorted_scalar(val, n, i);
+}
+
+static M_AVX2 size_t m_array_dbl_near_avx2(const double *exp,
+					   const double *val, size_t n,
+					   double abs_tol, double rel_tol)
+{
+	__m256d sign = _mm256_set1_pd(-0.0);
+	__m256d at = _mm256_set1_pd(abs_tol), rt = _mm256_set1_pd(rel_tol);
+	size_t i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m256d e = _mm256_loadu_pd(exp + i);
+		__m256d v = _mm256_loadu_pd(val + i);
+		__m256d err = _mm256_andnot_pd(sign, _mm256_sub_pd(e, v));
+		__m256d tol = _mm256_max_pd(at, _mm256_mul_pd(rt,
+						_mm256_andnot_pd(sign, e)));
+		__m256d ok = _mm256_or_pd(_mm256_cmp_pd(e, v, _CMP_EQ_OQ),
+					  _mm256_cmp_pd(err, tol, _CMP_LE_OQ));
+
+		if (_mm256_movemask_pd(ok) != 0xF)
+			break;
+	}
+	return m_array_dbl_near_scalar(exp, val, n, abs_tol, rel_tol, i);
+}
+
+static M_AVX2 void m_mem_diff_avx2(const unsigned char *a,
+				   const unsigned char *b, size_t n,
+				   struct m_mem_diff *d)
+{
+	size_t i;
+
+	for (i = 0; i + M_MEM_BLOCK <= n; i += M_MEM_BLOCK) {
+		__m256i x0 = _mm256_loadu_si256((const __m256i *)(a + i));
+		__m256i y0 = _mm256_loadu_si256((const __m256i *)(b + i));
+		__m256i x1 = _mm256_loadu_si256((const __m256i *)(a + i + 32));
+		__m256i y1 = _mm256_loadu_si256((const __m256i *)(b + i + 32));
+		uint32_t eq0 = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x0, y0));
+		uint32_t eq1 = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x1, y1));
+
+		m_mem_diff_block(d, i, ~((uint64_t)eq1 << 32 | eq0));
+	}
+	m_mem_diff_scalar(a, b, n, i, d);
+}
+
+static M_AVX2 M_NO_ASAN size_t m_str_diff_avx2(const char *a, const char *b,
+					       size_t n)
+{
+	__m256i x, y, zero = _mm256_setzero_si256();
+	uint32_t stop;
+	size_t i = 0;
+
+	while (i < n) {
+		if (n - i < 32 || m_page_cross(a + i, 32) ||
+		    m_page_cross(b + i, 32)) {
+			size_t end = n - i < 32 ? n : i + 32;
+			size_t pos = m_str_diff_scalar(a, b, n, i, end);
+
+			if (pos < n)
+				return pos;
+			i = end;
+			continue;
+		}
+		x = _mm256_loadu_si256((const __m256i *)(a + i));
+		y = _mm256_loadu_si256((const __m256i *)(b + i));
+		stop = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) |
+			(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, zero));
+		if (stop)
+			return i + __builtin_ctz(stop);
+		i += 32;
+	}
+	return n;
+}
+
+static M_AVX512 size_t m_array_int_eq_avx512(const int *exp, const int *val,
+					     size_t n)
+{
+	size_t i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__m512i e = _mm512_loadu_si512(exp + i);
+		__m512i v = _mm512_loadu_si512(val + i);
+
+		if (_mm512_cmpneq_epi32_mask(e, v))
+			break;
+	}
+	return m_array_int_eq_scalar(exp, val, n, i);
+}
+
+static M_AVX512 size_t m_array_int_range_avx512(int min, int max,
+						const int *val, size_t n)
+{
+	__m512i lo = _mm512_set1_epi32(min), hi = _mm512_set1_epi32(max);
+	size_t i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		__m512i v = _mm512_loadu_si512(val + i);
+
+		if (_mm512_cmplt_epi32_mask(v, lo) |
+		    _mm512_cmpgt_epi32_mask(v, hi))
+			break;
+	}
+	return m_array_int_range_scalar(min, max, val, n, i);
+}
+
+static M_AVX512 size_t m_array_int_sorted_avx512(const int *val, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i + 16 < n; i += 16) {
+		__m512i a = _mm512_loadu_si512(val + i);
+		__m512i b = _mm512_loadu_si512(val + i + 1);
+
+		if (_mm512_cmpgt_epi32_mask(a, b))
+			break;
+	}
+	return m_array_int_sorted_scalar(val, n, i);
+}
+
+static M_AVX512 size_t m_array_dbl_near_avx512(const double *exp,
+					       const double *val, size_t n,
+					       double abs_tol, double rel_tol)
+{
+	__m512d at = _mm512_set1_pd(abs_tol), rt = _mm512_set1_pd(rel_tol);
+	size_t i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m512d e = _mm512_loadu_pd(exp + i);
+		__m512d v = _mm512_loadu_pd(val + i);
+		__m512d err = _mm512_abs_pd(_mm512_sub_pd(e, v));
+		__m512d tol = _mm512_max_pd(at, _mm512_mul_pd(rt,
+							_mm512_abs_pd(e)));
+		__mmask8 ok = _mm512_cmp_pd_mask(e, v, _CMP_EQ_OQ) |
+			      _mm512_cmp_pd_mask(err, tol, _CMP_LE_OQ);
+
+		if (ok != 0xFF)
+			break;
+	}
+	return m_array_dbl_near_scalar(exp, val, n, abs_tol, rel_tol, i);
+}
+
+/*
+ * One compare covers a whole M_MEM_BLOCK, and the masked load of the
+ * tail does not touch the bytes past the end
+ */
+static M_AVX512 void m_mem_diff_avx512(const unsigned char *a,
+				       const unsigned char *b, size_t n,
+				       struct m_mem_diff *d)
+{
+	__mmask64 k = ~0ULL;
+	size_t i;
+
+	for (i = 0; i < n; i += M_MEM_BLOCK) {
+		if (n - i < M_MEM_BLOCK)
+			k = (1ULL << (n - i)) - 1;
+		m_mem_diff_block(d, i, _mm512_mask_cmpneq_epi8_mask(k,
+					_mm512_maskz_loadu_epi8(k, a + i),
+					_mm512_maskz_loadu_epi8(k, b + i)));
+	}
+}
+
+/*
+ * Masked loads stop at the end of the page of either string, so there is
+ * no scalar fallback
+ */
+static M_AVX512 M_NO_ASAN size_t m_str_diff_avx512(const char *a,
+						   const char *b, size_t n)
+{
+	__m512i x, y;
+	__mmask64 k, stop;
+	size_t i = 0, len, pa, pb;
+
+	while (i < n) {
+		len = n - i < 64 ? n - i : 64;
+		pa = 4096 - ((uintptr_t)(a + i) & 4095);
+		pb = 4096 - ((uintptr_t)(b + i) & 4095);
+		if (pa < len)
+			len = pa;
+		if (pb < len)
+			len = pb;
+		k = len < 64 ? (1ULL << len) - 1 : ~0ULL;
+		x = _mm512_maskz_loadu_epi8(k, a + i);
+		y = _mm512_maskz_loadu_epi8(k, b + i);
+		stop = _mm512_mask_cmpneq_epi8_mask(k, x, y) |
+		       _mm512_mask_cmpeq_epi8_mask(k, x,
+						   _mm512_setzero_si512());
+		if (stop)
+			return i + __builtin_ctzll(stop);
+		i += len;
+	}
+	return n;
+}
+
+static const struct m_array_ops m_array_sse2 = {
+	.name = "SSE2",
+	.int_eq = m_array_int_eq_sse2,
+	.int_range = m_array_int_range_sse2,
+	.int_sorted = m_array_int_sorted_sse2,
+	.dbl_near = m_array_dbl_near_sse2,
+	.mem_diff = m_mem_diff_sse2,
+	.str_diff = m_str_diff_sse2,
+};
+
+static const struct m_array_ops m_array_avx2 = {
+	.name = "AVX2",
+	.int_eq = m_array_int_eq_avx2,
+	.int_range = m_array_int_range_avx2,
+	.int_sorted = m_array_int_sorted_avx2,
+	.dbl_near = m_array_dbl_near_avx2,
+	.mem_diff = m_mem_diff_avx2,
+	.str_diff = m_str_diff_avx2,
+};
+
+static const struct m_array_ops m_array_avx512 = {
+	.name = "AVX-512",
+	.int_eq = m_array_int_eq_avx512,
+	.int_range = m_array_int_range_avx512,
+	.int_sorted = m_array_int_sorted_avx512,
+	.dbl_near = m_array_dbl_near_avx512,
+	.mem_diff = m_mem_diff_avx512,
+	.str_diff = m_str_diff_avx512,
+};
+#endif
+
+/**
+ * It selects, once, the array kernels for the running CPU
+ * @return the array kernels
+ */
+static const struct m_array_ops *m_array_ops(void)
+{
+	static const struct m_array_ops *ops;
+	const struct m_array_ops *sel;
+
+	sel = __atomic_load_n(&ops, __ATOMIC_RELAXED);
+	if (sel)
+		return sel;
+
+	sel = &m_array_scalar;
+#ifdef M_ARRAY_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") &&
+	    __builtin_cpu_supports("avx512bw"))
+		sel = &m_array_avx512;
+	else if (__builtin_cpu_supports("avx2"))
+		sel = &m_array_avx2;
+	else if (__builtin_cpu_supports("sse2"))
+		sel = &m_array_sse2;
+#endif
+	__atomic_store_n(&ops, sel, __ATOMIC_RELAXED);
+
+	return sel;
+}
+
+/**
+ * It compares two strings like strncmp() does
+ * @param[in] a first string
+ * @param[in] b second string
+ * @param[in] n maximum number of characters to compare
+ * @return less than, equal to or greater than zero when a is found to be
+ *         less than, to match or to be greater than b
+ */
+static int m_str_ncmp(const char *a, const char *b, size_t n)
+{
+	size_t i = m_array_ops()->str_diff(a, b, n);
+
+	if (i == n)
+		return 0;
+	return (unsigned char)a[i] - (unsigned char)b[i];
+}
+
+/**
+ * Characters of a string shown before its first difference
+ */
+#define M_STR_CONTEXT 16
+
+/**
+ * Characters of a string shown in a failure message
+ */
+#define M_STR_EXCERPT 64
+
+/**
+ * It writes a printable excerpt of a string, starting a little before the
+ * given position. Non-printable characters are escaped, cuts are marked
+ * with "..."
+ * @param[out] out excerpt buffer, at least M_STR_EXCERPT * 4 + 7 bytes
+ * @param[in] str the string
+ * @param[in] n maximum string length
+ * @param[in] pos position of interest
+ */
+static void m_str_excerpt(char *out, const char *str, size_t n, size_t pos)
+{
+	size_t i, end;
+
+	if (!str) {
+		strcpy(out, "(null)");
+		return;
+	}
+
+	i = pos > M_STR_CONTEXT ? pos - M_STR_CONTEXT : 0;
+	end = n - i > M_STR_EXCERPT ? i + M_STR_EXCERPT : n;
+	if (i)
+		out += sprintf(out, "...");
+	for (; i < end && str[i]; ++i) {
+		if (isprint((unsigned char)str[i]))
+			*out++ = str[i];
+		else
+			out += sprintf(out, "\\x%02x", (unsigned char)str[i]);
+	}
+	if (i < n && str[i])
+		out += sprintf(out, "...");
+	*out = '\0';
+}
+
+/**
+ * Rows of 16 bytes dumped around the first difference of two memory areas
+ */
+#define M_MEM_DUMP_ROWS 4
+
+/**
+ * It prints where two memory areas differ: a summary of the differences
+ * and a hexdump of both areas around the first one, with the differing
+ * bytes marked
+ * @param[in] exp expected memory content
+ * @param[in] val memory content to compare with
+ * @param[in] n size of the memory areas
+ */
+static void m_mem_diff_print(const unsigned char *exp,
+			     const unsigned char *val, size_t n)
+{
+	struct m_mem_diff d = { .first = n };
+	size_t start, end, off, j, len;
+	char mark[16 * 3 + 1];
+
+	m_array_ops()->mem_diff(exp, val, n, &d);
+	if (!d.bytes)
+		return;
+
+	m_out("  First difference at offset %zu (0x%zx), %zu bytes differ in %zu of %zu blocks of %u bytes\n",
+		d.first, d.first, d.bytes, d.blocks,
+		(n + M_MEM_BLOCK - 1) / M_MEM_BLOCK, M_MEM_BLOCK);
+
+	/* One row of context before the first difference */
+	start = d.first & ~(size_t)15;
+	start = start >= 16 ? start - 16 : 0;
+	end = n - start > M_MEM_DUMP_ROWS * 16 ? start + M_MEM_DUMP_ROWS * 16 : n;
+	for (off = start; off < end; off += 16) {
+		len = end - off < 16 ? end - off : 16;
+		m_out("  exp %08zx:", off);
+		for (j = 0; j < len; ++j)
+			m_out(" %02x", exp[off + j]);
+		m_out("\n  val %08zx:", off);
+		for (j = 0; j < len; ++j)
+			m_out(" %02x", val[off + j]);
+		m_out_puts("\n");
+
+		if (!memcmp(exp + off, val + off, len))
+			continue;
+		for (j = 0; j < len; ++j)
+			memcpy(mark + j * 3, exp[off + j] != val[off + j] ?
+			       " ^^" : "   ", 3);
+		while (len && exp[off + len - 1] == val[off + len - 1])
+			len--;
+		mark[len * 3] = '\0';
+		m_out("               %s\n", mark);
+	}
+}
+
+/**
+ * It verifies that two int arrays are equal
+ * @param[in] flags check options
+ * @param[in] func function name that called this function
+ * @param[in] line source code line where this function has being called
+ * @param[in] exp expected values
+ * @param[in] val values to compare with
+ * @param[in] n number of elements
+ */
+void m_check_array_int_eq(unsigned long flags, const char *func,
+			  const unsigned int line, const int *exp,
+			  const int *val, size_t n)
+{
+	size_t i, first, count = 0;
+	long long err, max_err = 0;
+
+	first = m_array_ops()->int_eq(exp, val, n);
+	if (M_LIKELY(first == n))
+		return;
+
+	for (i = first; i < n; ++i) {
+		err = llabs((long long)exp[i] - val[i]);
+		count += (err != 0);
+		if (err > max_err)
+			max_err = err;
+	}
+	m_check_failed(M_INT_ARRAY_EQ, flags, func, line, val[first], first,
+		       exp[first], count, n, max_err);
+}
+
+/**
+ * It verifies that all the values of an int array are within a range
+ * @param[in] flags check options
+ * @param[in] func function name that called this function
+ * @param[in] line source code line where this function has being called
+ * @param[in] min minimum expected value
+ * @param[in] max maximum expected value
+ * @param[in] val values to compare with
+ * @param[in] n number of elements
+ */
+void m_check_array_int_range(unsigned long flags, const char *func,
+			     const unsigned int line, int min, int max,
+			     const int *val, size_t n)
+{
+	size_t i, first, count = 0;
+	long long err, max_err = 0;
+
+	first = m_array_ops()->int_range(min, max, val, n);
+	if (M_LIKELY(first == n))
+		return;
+
+	for (i = first; i < n; ++i) {
+		if (val[i] < min)
+			err = (long long)min - val[i];
+		else if (val[i] > max)
+			err = (long long)val[i] - max;
+		else
+			continue;
+		count++;
+		if (err > max_err)
+			max_err = err;
+	}
+	m_check_failed(M_INT_ARRAY_RANGE, flags, func, line, min, max,
+		       val[first], first, count, n, max_err);
+}
+
+/**
+ * It verifies that an int array is in non-decreasing order
+ * @param[in] flags check options
+ * @param[in] func function name that called this function
+ * @param[in] line source code line where this function has being called
+ * @param[in] val values to verify
+ * @param[in] n number of elements
+ */
+void m_check_array_int_sorted(unsigned long flags, const char *func,
+			      const unsigned int line, const int *val,
+			      size_t n)
+{
+	size_t i, first, count = 0;
+	long long err, max_err = 0;
+
+	first = m_array_ops()->int_sorted(val, n);
+	if (M_LIKELY(first == n))
+		return;
+
+	for (i = first; i < n; ++i) {
+		err = (long long)val[i - 1] - val[i];
+		if (err <= 0)
+			continue;
+		count++;
+		if (err > max_err)
+			max_err = err;
+	}
+	m_check_failed(M_INT_ARRAY_SORTED, flags, func, line, val[first], first,
+		       val[first - 1], first - 1, count, n, max_err);
+}
+
+/**
+ * It verifies that two double arrays are equal within a tolerance
+ * @param[in] flags check options
+ * @param[in] func function name that called this function
+ * @param[in] line source code line where this function has being called
+ * @param[in] exp expected values
+ * @param[in] val values to compare with
+ * @param[in] n number of elements
+ * @param[in] abs_tol absolute tolerance
+ * @param[in] rel_tol tolerance relative to the expected value
+ */
+void m_check_array_dbl_near(unsigned long flags, const char *func,
+			    const unsigned int line, const double *exp,
+			    const double *val, size_t n,
+			    double abs_tol, double rel_tol)
+{
+	size_t i, first, count = 0;
+	double err, max_err = 0;
+
+	first = m_array_ops()->dbl_near(exp, val, n, abs_tol, rel_tol);
+	if (M_LIKELY(first == n))
+		return;
+
+	for (i = first; i < n; ++i) {
+		if (m_array_dbl_near_one(exp[i], val[i], abs_tol, rel_tol))
+			continue;
+		count++;
+		err = fabs(exp[i] - val[i]);
+		if (isnan(err) || err > max_err)
+			max_err = err; /* NaN sticks */
+	}
+	m_check_failed(M_DBL_ARRAY_NEAR, flags, func, line, val[first], first,
+		       exp[first], count, n, max_err, abs_tol, rel_tol);
+}
+
+
+
+/* -------------------------------------------------------------------- */
+/* Following all implemented test conditions - comment only when needed */
+/* -------------------------------------------------------------------- */
+
+static int m_cond_true(va_list args)
+{
+	return !!va_arg(args, int);
+}
+
+static int m_cond_false(va_list args)
+{
+	return !m_cond_true(args);
+}
+
+
+
+static int m_cond_int_equal(va_list args)
+{
+	int a, b;
+
+	a = va_arg(args, long);
+	b = va_arg(args, long);
+
+	return (a == b);
+}
+
+static int m_cond_int_not_equal(va_list args)
+{
+	return !m_cond_int_equal(args);
+}
+
+static int m_cond_int_greater_than(va_list args)
+{
+	int a, b;
+
+	a = va_arg(args, long);
+	b = va_arg(args, long);
+
+	return (a > b);
+}
+
+static int m_cond_int_greater_equal(va_list args)
+{
+	va_list args_bis;
+	int cond;
+
+	va_copy(args_bis, args);
+	cond = (m_cond_int_greater_than(args) || m_cond_int_equal(args_bis));
+	va_end(args_bis);
+
+	return cond;
+}
+
+static int m_cond_int_less_than(va_list args)
+{
+	return !m_cond_int_greater_equal(args);
+}
+
+static int m_cond_int_less_equal(va_list args)
+{
+	return !m_cond_int_greater_than(args);
+}
+
+static int m_cond_int_in_range(va_list args)
+{
+	int min, max, val;
+
+	min = va_arg(args, long);
+	max = va_arg(args, long);
+	val = va_arg(args, long);
+
+	return (min <= val && val <= max);
+}
+
+static int m_cond_int_not_in_range(va_list args)
+{
+	return !m_cond_int_in_range(args);
+}
+
+static int m_cond_i64_equal(va_list args)
+{
+	int64_t a, b;
+
+	a = va_arg(args, int64_t);
+	b = va_arg(args, int64_t);
+
+	return (a == b);
+}
+
+static int m_cond_i64_not_equal(va_list args)
+{
+	return !m_cond_i64_equal(args);
+}
+
+static int m_cond_i64_greater_than(va_list args)
+{
+	int64_t a, b;
+
+	a = va_arg(args, int64_t);
+	b = va_arg(args, int64_t);
+
+	return (a > b);
+}
+
+static int m_cond_i64_greater_equal(va_list args)
+{
+	int64_t a, b;
+
+	a = va_arg(args, int64_t);
+	b = va_arg(args, int64_t);
+
+	return (a >= b);
+}
+
+static int m_cond_i64_less_than(va_list args)
+{
+	return !m_cond_i64_greater_equal(args);
+}
+
+static int m_cond_i64_less_equal(va_list args)
+{
+	return !m_cond_i64_greater_than(args);
+}
+
+static int m_cond_i64_in_range(va_list args)
+{
+	int64_t min, max, val;
+
+	min = va_arg(args, int64_t);
+	max = va_arg(args, int64_t);
+	val = va_arg(args, int64_t);
+
+	return (min <= val && val <= max);
+}
+
+static int m_cond_i64_not_in_range(va_list args)
+{
+	return !m_cond_i64_in_range(args);
+}
+
+static int m_cond_u64_equal(va_list args)
+{
+	uint64_t a, b;
+
+	a = va_arg(args, uint64_t);
+	b = va_arg(args, uint64_t);
+
+	return (a == b);
+}
+
+static int m_cond_u64_not_equal(va_list args)
+{
+	return !m_cond_u64_equal(args);
+}
+
+static int m_cond_u64_greater_than(va_list args)
+{
+	uint64_t a, b;
+
+	a = va_arg(args, uint64_t);
+	b = va_arg(args, uint64_t);
+
+	return (a > b);
+}
+
+static int m_cond_u64_greater_equal(va_list args)
+{
+	uint64_t a, b;
+
+	a = va_arg(args, uint64_t);
+	b = va_arg(args, uint64_t);
+
+	return (a >= b);
+}
+
+static int m_cond_u64_less_than(va_list args)
+{
+	return !m_cond_u64_greater_equal(args);
+}
+
+static int m_cond_u64_less_equal(va_list args)
+{
+	return !m_cond_u64_greater_than(args);
+}
+
+static int m_cond_u64_in_range(va_list args)
+{
+	uint64_t min, max, val;
+
+	min = va_arg(args, uint64_t);
+	max = va_arg(args, uint64_t);
+	val = va_arg(args, uint64_t);
+
+	return (min <= val && val <= max);
+}
+
+static int m_cond_u64_not_in_range(va_list args)
+{
+	return !m_cond_u64_in_range(args);
+}
+
+static int m_cond_size_equal(va_list args)
+{
+	size_t a, b;
+
+	a = va_arg(args, size_t);
+	b = va_arg(args, size_t);
+
+	return (a == b);
+}
+
+static int m_cond_size_not_equal(va_list args)
+{
+	return !m_cond_size_equal(args);
+}
+
+static int m_cond_size_greater_than(va_list args)
+{
+	size_t a, b;
+
+	a = va_arg(args, size_t);
+	b = va_arg(args, size_t);
+
+	return (a > b);
+}
+
+static int m_cond_size_greater_equal(va_list args)
+{
+	size_t a, b;
+
+	a = va_arg(args, size_t);
+	b = va_arg(args, size_t);
+
+	return (a >= b);
+}
+
+static int m_cond_size_less_than(va_list args)
+{
+	return !m_cond_size_greater_equal(args);
+}
+
+static int m_cond_size_less_equal(va_list args)
+{
+	return !m_cond_size_greater_than(args);
+}
+
+static int m_cond_size_in_range(va_list args)
+{
+	size_t min, max, val;
+
+	min = va_arg(args, size_t);
+	max = va_arg(args, size_t);
+	val = va_arg(args, size_t);
+
+	return (min <= val && val <= max);
+}
+
+static int m_cond_size_not_in_range(va_list args)
+{
+	return !m_cond_size_in_range(args);
+}
+
+
+
+static int m_cond_dbl_equal(va_list args)
+{
+	double a, b;
+
+	a = va_arg(args, double);
+	b = va_arg(args, double);
+
+	return (a == b);
+}
+
+static int m_cond_dbl_not_equal(va_list args)
+{
+	return !m_cond_dbl_equal(args);
+}
+
+static int m_cond_dbl_greater_than(va_list args)
+{
+	double a, b;
+
+	a = va_arg(args, double);
+	b = va_arg(args, double);
+
+	return (a > b);
+}
+
+static int m_cond_dbl_greater_equal(va_list args)
+{
+	va_list args_bis;
+	int cond;
+
+	va_copy(args_bis, args);
+	cond = (m_cond_dbl_greater_than(args) || m_cond_dbl_equal(args_bis));
+	va_end(args_bis);
+
+	return cond;
+}
+
+static int m_cond_dbl_less_than(va_list args)
+{
+	return !m_cond_dbl_greater_equal(args);
+}
+
+static int m_cond_dbl_less_equal(va_list args)
+{
+	return !m_cond_dbl_greater_than(args);
+}
+
+static int m_cond_dbl_in_range(va_list args)
+{
+	double min, max, val;
+
+	min = va_arg(args, double);
+	max = va_arg(args, double);
+	val = va_arg(args, double);
+
+	return (min <= val && val <= max);
+}
+
+static int m_cond_dbl_not_in_range(va_list args)
+{
+	return !m_cond_dbl_in_range(args);
+}
+
+
+
+static int m_cond_ptr_null(va_list args)
+{
+	void *ptr;
+
+	ptr = va_arg(args, void*);
+
+	return (ptr == NULL);
+}
+
+static int m_cond_ptr_not_null(va_list args)
+{
+	return !m_cond_ptr_null(args);
+}
+
+
+static int m_cond_mem_eq(va_list args)
+{
+	void *ptr1, *ptr2;
+	size_t size;
+
+	ptr1 = va_arg(args, void*);
+	ptr2 = va_arg(args, void*);
+	size = va_arg(args, size_t);
+
+	return (memcmp(ptr1, ptr2, size) == 0);
+}
+
+static int m_cond_mem_neq(va_list args)
+{
+	return !m_cond_mem_eq(args);
+}
+
+static int m_cond_mem_greater_than(va_list args)
+{
+	void *a, *b;
+	size_t n;
+
+	a = va_arg(args, void*);
+	b = va_arg(args, void*);
+	n = va_arg(args, size_t);
+
+	return (memcmp(a, b, n) > 0);
+}
+
+
+/**
+ * Implement the function instead of re-use the others (like we did for
+ * int and double) in order to avoid double memory scanning
+ */
+static int m_cond_mem_greater_equal(va_list args)
+{
+	void *a, *b;
+	size_t n;
+
+	a = va_arg(args, void*);
+	b = va_arg(args, void*);
+	n = va_arg(args, size_t);
+
+	return (memcmp(a, b, n) >= 0);
+}
+
+static int m_cond_mem_less_than(va_list args)
+{
+	return !m_cond_mem_greater_equal(args);
+}
+
+static int m_cond_mem_less_equal(va_list args)
+{
+	return !m_cond_mem_greater_than(args);
+}
+
+static int m_cond_mem_in_range(va_list args)
+{
+	void *min, *max, *val;
+	size_t n;
+
+	min = va_arg(args, void*);
+	max = va_arg(args, void*);
+	val = va_arg(args, void*);
+	n = va_arg(args, size_t);
+
+	return (memcmp(min, val, n) <= 0 && memcmp(val, max, n) <= 0);
+}
+
+/**
+ * Implement the function instead of re-use the others (like we did for
+ * int and double) in order to avoid double memory scanning
+ */
+static int m_cond_mem_not_in_range(va_list args)
+{
+	void *min, *max, *val;
+	size_t n;
+
+	min = va_arg(args, void*);
+	max = va_arg(args, void*);
+	val = va_arg(args, void*);
+	n = va_arg(args, size_t);
+
+	return (memcmp(min, val, n) > 0 || memcmp(val, max, n) > 0);
+}
+
+
+static int m_cond_str_eq(va_list args)
+{
+	char *ptr1, *ptr2;
+	size_t size;
+
+	ptr1 = va_arg(args, char*);
+	ptr2 = va_arg(args, char*);
+	size = va_arg(args, size_t);
+
+	return (m_str_ncmp(ptr1, ptr2, size) == 0);
+}
+
+static int m_cond_str_neq(va_list args)
+{
+	return !m_cond_str_eq(args);
+}
+
+static int m_cond_str_greater_than(va_list args)
+{
+	char *a, *b;
+	size_t size;
+
+	a = va_arg(args, char*);
+	b = va_arg(args, char*);
+	size = va_arg(args, size_t);
+
+	return (m_str_ncmp(a, b, size) > 0);
+}
+
+
+/**
+ * Implement the function instead of re-use the others (like we did for
+ * int and double) in order to avoid double strory scanning
+ */
+static int m_cond_str_greater_equal(va_list args)
+{
+	char *a, *b;
+	size_t size;
+
+	a = va_arg(args, char*);
+	b = va_arg(args, char*);
+	size = va_arg(args, size_t);
+
+	return (m_str_ncmp(a, b, size) >= 0);
+}
+
+static int m_cond_str_less_than(va_list args)
+{
+	return !m_cond_str_greater_equal(args);
+}
+
+static int m_cond_str_less_equal(va_list args)
+{
+	return !m_cond_str_greater_than(args);
+}
+
+static int m_cond_str_in_range(va_list args)
+{
+	char *min, *max, *val;
+	size_t size;
+
+	min = va_arg(args, char*);
+	max = va_arg(args, char*);
+	val = va_arg(args, char*);
+	size = va_arg(args, size_t);
+
+	return (m_str_ncmp(min, val, size) <= 0 &&
+		m_str_ncmp(val, max, size) <= 0);
+}
+
+/**
+ * Implement the function instead of re-use the others (like we did for
+ * int and double) in order to avoid double string scanning
+ */
+static int m_cond_str_not_in_range(va_list args)
+{
+	char *min, *max, *val;
+	size_t size;
+
+	min = va_arg(args, char*);
+	max = va_arg(args, char*);
+	val = va_arg(args, char*);
+	size = va_arg(args, size_t);
+
+	return (m_str_ncmp(min, val, size) > 0 ||
+		m_str_ncmp(val, max, size) > 0);
 }
 
 
@@ -583,35 +4252,35 @@ static const struct m_assertion asserts[] = {
 	/* Integer */
 	[M_INT_EQ] = {
 		.condition = m_cond_int_equal,
-		.fmt = "Expected <%d>, but got <%d>",
+		.fmt = "Expected <%ld>, but got <%ld>",
 	},
 	[M_INT_NEQ] = {
 		.condition = m_cond_int_not_equal,
-		.fmt = "Expected any but not <%d>, but got <%d>",
+		.fmt = "Expected any but not <%ld>, but got <%ld>",
 	},
 	[M_INT_RANGE] = {
 		.condition = m_cond_int_in_range,
-		.fmt = "Expected in range [%d, %d], but got <%d>",
+		.fmt = "Expected in range [%ld, %ld], but got <%ld>",
 	},
 	[M_INT_NRANGE] = {
 		.condition = m_cond_int_not_in_range,
-		.fmt = "Expected outside range [%d, %d], but got <%d>",
+		.fmt = "Expected outside range [%ld, %ld], but got <%ld>",
 	},
 	[M_INT_GT] = {
 		.condition = m_cond_int_greater_than,
-		.fmt = "Expected <%d> greater than <%d>",
+		.fmt = "Expected <%ld> greater than <%ld>",
 	},
 	[M_INT_GE] = {
 		.condition = m_cond_int_greater_equal,
-		.fmt = "Expected <%d> greater or equal than <%d>",
+		.fmt = "Expected <%ld> greater or equal than <%ld>",
 	},
 	[M_INT_LT] = {
 		.condition = m_cond_int_less_than,
-		.fmt = "Expected <%d> less than <%d>",
+		.fmt = "Expected <%ld> less than <%ld>",
 	},
 	[M_INT_LE] = {
 		.condition = m_cond_int_less_equal,
-		.fmt = "Expected <%d> less or equal than <%d>",
+		.fmt = "Expected <%ld> less or equal than <%ld>",
 	},
 	/* Floating Point */
 	[M_DBL_EQ] = {
@@ -725,15 +4394,172 @@ static const struct m_assertion asserts[] = {
 	/* Errno */
 	[M_ERR_EQ] = {
 		.condition = m_cond_int_equal,
-		.fmt = "Expected errno <%d>, but got <%d>",
+		.fmt = "Expected errno <%ld>, but got <%ld>",
 	},
 	[M_ERR_NEQ] = {
 		.condition = m_cond_int_not_equal,
-		.fmt = "Expected any but not errno <%d>, but got <%d>",
+		.fmt = "Expected any but not errno <%ld>, but got <%ld>",
+	},
+	/* 64-bit Integer */
+	[M_I64_EQ] = {
+		.condition = m_cond_i64_equal,
+		.fmt = "Expected <%" PRId64 ">, but got <%" PRId64 ">",
+	},
+	[M_I64_NEQ] = {
+		.condition = m_cond_i64_not_equal,
+		.fmt = "Expected any but not <%" PRId64 ">, but got <%" PRId64 ">",
+	},
+	[M_I64_RANGE] = {
+		.condition = m_cond_i64_in_range,
+		.fmt = "Expected in range [%" PRId64 ", %" PRId64 "], but got <%" PRId64 ">",
+	},
+	[M_I64_NRANGE] = {
+		.condition = m_cond_i64_not_in_range,
+		.fmt = "Expected outside range [%" PRId64 ", %" PRId64 "], but got <%" PRId64 ">",
+	},
+	[M_I64_GT] = {
+		.condition = m_cond_i64_greater_than,
+		.fmt = "Expected <%" PRId64 "> greater than <%" PRId64 ">",
+	},
+	[M_I64_GE] = {
+		.condition = m_cond_i64_greater_equal,
+		.fmt = "Expected <%" PRId64 "> greater or equal than <%" PRId64 ">",
+	},
+	[M_I64_LT] = {
+		.condition = m_cond_i64_less_than,
+		.fmt = "Expected <%" PRId64 "> less than <%" PRId64 ">",
+	},
+	[M_I64_LE] = {
+		.condition = m_cond_i64_less_equal,
+		.fmt = "Expected <%" PRId64 "> less or equal than <%" PRId64 ">",
+	},
+	/* 64-bit Unsigned Integer */
+	[M_U64_EQ] = {
+		.condition = m_cond_u64_equal,
+		.fmt = "Expected <%" PRIu64 ">, but got <%" PRIu64 ">",
+	},
+	[M_U64_NEQ] = {
+		.condition = m_cond_u64_not_equal,
+		.fmt = "Expected any but not <%" PRIu64 ">, but got <%" PRIu64 ">",
+	},
+	[M_U64_RANGE] = {
+		.condition = m_cond_u64_in_range,
+		.fmt = "Expected in range [%" PRIu64 ", %" PRIu64 "], but got <%" PRIu64 ">",
+	},
+	[M_U64_NRANGE] = {
+		.condition = m_cond_u64_not_in_range,
+		.fmt = "Expected outside range [%" PRIu64 ", %" PRIu64 "], but got <%" PRIu64 ">",
+	},
+	[M_U64_GT] = {
+		.condition = m_cond_u64_greater_than,
+		.fmt = "Expected <%" PRIu64 "> greater than <%" PRIu64 ">",
+	},
+	[M_U64_GE] = {
+		.condition = m_cond_u64_greater_equal,
+		.fmt = "Expected <%" PRIu64 "> greater or equal than <%" PRIu64 ">",
+	},
+	[M_U64_LT] = {
+		.condition = m_cond_u64_less_than,
+		.fmt = "Expected <%" PRIu64 "> less than <%" PRIu64 ">",
+	},
+	[M_U64_LE] = {
+		.condition = m_cond_u64_less_equal,
+		.fmt = "Expected <%" PRIu64 "> less or equal than <%" PRIu64 ">",
+	},
+	/* Size */
+	[M_SIZE_EQ] = {
+		.condition = m_cond_size_equal,
+		.fmt = "Expected <%zu>, but got <%zu>",
+	},
+	[M_SIZE_NEQ] = {
+		.condition = m_cond_size_not_equal,
+		.fmt = "Expected any but not <%zu>, but got <%zu>",
+	},
+	[M_SIZE_RANGE] = {
+		.condition = m_cond_size_in_range,
+		.fmt = "Expected in range [%zu, %zu], but got <%zu>",
+	},
+	[M_SIZE_NRANGE] = {
+		.condition = m_cond_size_not_in_range,
+		.fmt = "Expected outside range [%zu, %zu], but got <%zu>",
+	},
+	[M_SIZE_GT] = {
+		.condition = m_cond_size_greater_than,
+		.fmt = "Expected <%zu> greater than <%zu>",
+	},
+	[M_SIZE_GE] = {
+		.condition = m_cond_size_greater_equal,
+		.fmt = "Expected <%zu> greater or equal than <%zu>",
+	},
+	[M_SIZE_LT] = {
+		.condition = m_cond_size_less_than,
+		.fmt = "Expected <%zu> less than <%zu>",
+	},
+	[M_SIZE_LE] = {
+		.condition = m_cond_size_less_equal,
+		.fmt = "Expected <%zu> less or equal than <%zu>",
+	},
+	/* Arrays, handled by m_check_array_*() */
+	[M_INT_ARRAY_EQ] = {
+		.condition = NULL,
+		.fmt = "Expected equal arrays, but got <%d> at [%zu] instead of <%d> (%zu of %zu elements differ, max error %lld)",
+	},
+	[M_INT_ARRAY_RANGE] = {
+		.condition = NULL,
+		.fmt = "Expected all in range [%d, %d], but got <%d> at [%zu] (%zu of %zu elements outside, max distance %lld)",
+	},
+	[M_INT_ARRAY_SORTED] = {
+		.condition = NULL,
+		.fmt = "Expected a sorted array, but got <%d> at [%zu] after <%d> at [%zu] (%zu of %zu elements out of order, max drop %lld)",
+	},
+	[M_DBL_ARRAY_NEAR] = {
+		.condition = NULL,
+		.fmt = "Expected close arrays, but got <%g> at [%zu] instead of <%g> (%zu of %zu elements differ, max error %g, tolerance abs %g rel %g)",
 	},
 };
 
 
+/**
+ * It prints the error message of a string assertion. Strings are printed
+ * as bounded excerpts around their first difference, which is reported
+ * as well
+ * @param[in] type type of assertion
+ * @param[in] fmt printf string format
+ * @param[in] args printf parameters
+ */
+static void m_print_str_msg(enum m_asserts type, const char *fmt,
+			    va_list args)
+{
+	char ex[3][M_STR_EXCERPT * 4 + 7];
+	const char *str[3] = {NULL, NULL, NULL};
+	unsigned int i, count;
+	size_t n, pos = 0;
+
+	count = (type == M_STR_RANGE || type == M_STR_NRANGE) ? 3 : 2;
+	for (i = 0; i < count; ++i)
+		str[i] = va_arg(args, const char *);
+	n = va_arg(args, size_t);
+	if (count == 2 && str[0] && str[1])
+		pos = m_array_ops()->str_diff(str[0], str[1], n);
+	for (i = 0; i < count; ++i)
+		m_str_excerpt(ex[i], str[i], n, pos);
+
+	m_out(fmt, ex[0], ex[1], ex[2]);
+	if (count == 2 && str[0] && str[1] && pos < n &&
+	    (str[0][pos] || str[1][pos]))
+		m_out(" - first difference at position %zu", pos);
+}
+
+/**
+ * It tells if the calling thread is running a test. Threads spawned by a
+ * test do not share its run context
+ * @return 1 when a test runs in the calling thread, 0 otherwise
+ */
+static int m_test_thread(void)
+{
+	return status && status->m_test_cur;
+}
+
 /**
  * It prints on stdout the given error message
  * @param[in] type type of assertion
@@ -746,7 +4572,9 @@ static void  m_print_test_msg(enum m_asserts type, const char *fmt,
 			      const char *func, const unsigned int line,
 			      va_list args)
 {
-	struct m_suite *suite = status.m_test_cur->suite;
+	struct m_suite *suite = m_test_thread() ? status->m_test_cur->suite :
+						  NULL;
+	va_list dump;
 
 	/* print the error if there is a valid printf format */
 	if (!fmt)
@@ -758,15 +4586,60 @@ static void  m_print_test_msg(enum m_asserts type, const char *fmt,
 		va_arg(args, int);
 		va_arg(args, char*);
 	}
-	fprintf(stdout, "ERROR @ %s():%u - ", func, line);
-	vfprintf(stdout, fmt, args);
-	if ((suite->flags & M_ERRNO_FUNC) &&
+	m_out("ERROR @ %s():%u - ", func, line);
+	va_copy(dump, args);
+	if (type >= M_STR_EQ && type <= M_STR_LE)
+		m_print_str_msg(type, fmt, args);
+	else
+		m_vout(fmt, args);
+	if (suite && (suite->flags & M_ERRNO_FUNC) &&
 	    (type == M_ERR_EQ || type == M_ERR_NEQ))
-		fprintf(stdout, ": %s", suite->strerror(errno));
-	fputc('\n', stdout);
+		m_out(": %s", suite->strerror(errno));
+	m_out_puts("\n");
+
+	if (type == M_MEM_EQ) {
+		const unsigned char *exp = va_arg(dump, void *);
+		const unsigned char *val = va_arg(dump, void *);
+
+		m_mem_diff_print(exp, val, va_arg(dump, size_t));
+	}
+	va_end(dump);
 }
 
 
+/**
+ * It reports a failed assertion and it stops or continues the test
+ * according to the given flags
+ * @param[in] type type of assertion
+ * @param[in] flags check options
+ * @param[in] fmt printf string format
+ * @param[in] func function name that called this function
+ * @param[in] line source code line where this function has being called
+ * @param[in] args printf parameters
+ */
+static void m_check_fail(enum m_asserts type, unsigned long flags,
+			 const char *fmt, const char *func,
+			 const unsigned int line, va_list args)
+{
+	/* Print the error message */
+	m_print_test_msg(type, fmt, func, line, args);
+
+	/* Out of the test thread, the failure can only be reported */
+	if (!m_test_thread()) {
+		m_out("  Not in a test thread, no test to stop\n");
+		return;
+	}
+
+	/* According to the given flag, continue test execution or jump */
+	if (flags & M_FLAG_STOP_ON_ERROR) {
+		m_out("  Stop test \"%s\"\n", func);
+		m_state_go_to(M_STATE_TEST_ERROR);
+	} else {
+		m_out("  Continue test \"%s\" anyway\n", func);
+		status->m_test_cur->warnings++;
+	}
+}
+
 /**
  * Predefined check function.
  * @param[in] type type of assertion
@@ -787,6 +4660,7 @@ void m_check(enum m_asserts type, unsigned long flags,
 	if (type == M_CUSTOM) {
 		/* When custum, get all assertion data from variadic */
 		cond = va_arg(args, int);
+		va_arg(args, int); /* errno */
 		fmt = va_arg(args, char*);
 	} else {
 		/* Otherwas get assertion data from the table */
@@ -798,19 +4672,28 @@ void m_check(enum m_asserts type, unsigned long flags,
 	if (cond)
 		return; /* Condition satisfied */
 
-	/* Print the error message */
 	va_start(args, line);
-	m_print_test_msg(type, fmt, func, line, args);
+	m_check_fail(type, flags, fmt, func, line, args);
+	va_end(args);
+}
+
+/**
+ * Slow path of the inline assertions: the condition has already been
+ * evaluated, and it is not satisfied. It reports the failure.
+ * @param[in] type type of assertion
+ * @param[in] flags check options
+ * @param[in] func function name that called this function
+ * @param[in] line source code line where this function has being called
+ */
+void m_check_failed(enum m_asserts type, unsigned long flags,
+		    const char *func, const unsigned int line,
+		    ...)
+{
+	va_list args;
+
+	va_start(args, line);
+	m_check_fail(type, flags, asserts[type].fmt, func, line, args);
 	va_end(args);
-
-	/* According to the given flag, continue test execution or jump */
-	if (flags & M_FLAG_STOP_ON_ERROR) {
-		fprintf(stdout, "  Stop test \"%s\"\n", func);
-		m_state_go_to(M_STATE_TEST_ERROR);
-	} else {
-		fprintf(stdout, "  Continue test \"%s\" anyway\n", func);
-		status.m_test_cur->warnings++;
-	}
 }
 
 /**
@@ -821,15 +4704,14 @@ void m_check(enum m_asserts type, unsigned long flags,
  */
 void m_skip_test(unsigned int cond, const char *func, const unsigned int line)
 {
-	if (!cond)
+	if (!cond || !m_test_thread())
 		return;
-	fprintf(stdout, "SKIP@%s():%u\n", func, line);
+	m_out("SKIP@%s():%u\n", func, line);
 
 	m_state_go_to(M_STATE_TEST_SKIP);
 }
 
 
-
 /* -------------------------------------------------------------------- */
 /*                        Test Suite Management                         */
 /* -------------------------------------------------------------------- */
@@ -844,24 +4726,134 @@ static void m_suite_init(struct m_suite *suite)
 {
 	unsigned int i;
 
-	status.m_suite_cur = suite;
-	status.m_suite_cur->total_count = 0;
-	status.m_suite_cur->success_count = 0;
-	status.m_suite_cur->fail_count = 0;
-	status.m_suite_cur->skip_count = 0;
-	status.m_suite_cur->private = NULL;
-	if (!status.m_suite_cur->strerror)
-		status.m_suite_cur->strerror = strerror;
+	status->m_suite_cur = suite;
+	status->m_suite_cur->total_count = 0;
+	status->m_suite_cur->success_count = 0;
+	status->m_suite_cur->fail_count = 0;
+	status->m_suite_cur->skip_count = 0;
+	status->m_suite_cur->regression_count = 0;
+	status->m_suite_cur->timeout_count = 0;
+	status->m_suite_cur->cached_count = 0;
+	status->m_suite_cur->cancelled_count = 0;
+	status->m_suite_cur->private = NULL;
+	if (!status->m_suite_cur->strerror)
+		status->m_suite_cur->strerror = strerror;
 
 	for (i = 0; i < suite->test_count; i++) {
-		status.m_suite_cur->tests[i].private = NULL;
-		status.m_suite_cur->tests[i].index = i;
-		status.m_suite_cur->tests[i].suite = status.m_suite_cur;
-		status.m_suite_cur->tests[i].exit = M_STATE_EXIT_NORUN;
-		status.m_suite_cur->tests[i].warnings = 0;
+		status->m_suite_cur->tests[i].private = NULL;
+		status->m_suite_cur->tests[i].index = i;
+		status->m_suite_cur->tests[i].suite = status->m_suite_cur;
+		status->m_suite_cur->tests[i].exit = M_STATE_EXIT_NORUN;
+		status->m_suite_cur->tests[i].warnings = 0;
+		memset(&status->m_suite_cur->tests[i].time_set_up, 0,
+		       sizeof(struct m_time));
+		memset(&status->m_suite_cur->tests[i].time_test, 0,
+		       sizeof(struct m_time));
+		memset(&status->m_suite_cur->tests[i].time_tear_down, 0,
+		       sizeof(struct m_time));
+		memset(&status->m_suite_cur->tests[i].bench, 0,
+		       sizeof(struct m_bench_stats));
+		memset(&status->m_suite_cur->tests[i].perf, 0,
+		       sizeof(struct m_perf));
+	}
+}
+
+
+static int m_test_wall_cmp(const void *a, const void *b)
+{
+	uint64_t wa = m_test_wall(*(struct m_test **)a);
+	uint64_t wb = m_test_wall(*(struct m_test **)b);
+
+	return wa < wb ? 1 : wa > wb ? -1 : 0;
+}
+
+/**
+ * It prints the list of the slowest tests
+ * @param[in] m_suite the suite that we are interested in
+ */
+static void m_suite_summary_slowest(struct m_suite *m_suite)
+{
+	struct m_test **list;
+	unsigned int i, n = 0;
+
+	list = malloc(m_suite->test_count * sizeof(*list));
+	if (!list)
+		return;
+	for (i = 0; i < m_suite->test_count; ++i)
+		if (m_suite->tests[i].exit != M_STATE_EXIT_NORUN)
+			list[n++] = &m_suite->tests[i];
+	qsort(list, n, sizeof(*list), m_test_wall_cmp);
+	if (n > M_SUMMARY_SLOWEST)
+		n = M_SUMMARY_SLOWEST;
+
+	if (n)
+		fprintf(stdout, "\n%-16s%9s %9s %9s %9s %9s\n",
+			"Slowest (ms)", "Wall", "CPU",
+			"set_up", "test", "tear_down");
+	for (i = 0; i < n; ++i) {
+		struct m_test *m_test = list[i];
+
+		fprintf(stdout, "  Test %-7u  %9.3f %9.3f %9.3f %9.3f %9.3f  %.40s\n",
+			m_test->index,
+			m_test_wall(m_test) / 1e6,
+			(m_test->time_set_up.cpu + m_test->time_test.cpu +
+			 m_test->time_tear_down.cpu) / 1e6,
+			m_test->time_set_up.wall / 1e6,
+			m_test->time_test.wall / 1e6,
+			m_test->time_tear_down.wall / 1e6,
+			m_test->desc ? m_test->desc : "");
 	}
+
+	free(list);
 }
 
+/**
+ * It prints the performance counters of each test, per iteration
+ * @param[in] m_suite the suite that we are interested in
+ */
+static void m_suite_summary_perf(struct m_suite *m_suite)
+{
+	unsigned long valid = 0;
+	unsigned int i, c;
+
+	for (i = 0; i < m_suite->test_count; ++i)
+		valid |= m_suite->tests[i].perf.valid;
+	if (!valid)
+		return;
+
+	fprintf(stdout, "\n%-14s", "Counters/iter");
+	if ((valid & (1UL << M_PERF_CYCLES)) &&
+	    (valid & (1UL << M_PERF_INSTRUCTIONS)))
+		fprintf(stdout, " %6s", "IPC");
+	for (c = 0; c < _M_PERF_MAX; ++c)
+		if (valid & (1UL << c))
+			fprintf(stdout, " %10s", m_perf_events[c].name);
+	fputc('\n', stdout);
+
+	for (i = 0; i < m_suite->test_count; ++i) {
+		struct m_perf *perf = &m_suite->tests[i].perf;
+		uint64_t iter = perf->iterations ? perf->iterations : 1;
+
+		if (!perf->valid)
+			continue;
+		fprintf(stdout, "  Test %-7u", i);
+		if ((valid & (1UL << M_PERF_CYCLES)) &&
+		    (valid & (1UL << M_PERF_INSTRUCTIONS)))
+			fprintf(stdout, " %6.2f", perf->count[M_PERF_CYCLES] ?
+				(double)perf->count[M_PERF_INSTRUCTIONS] /
+				perf->count[M_PERF_CYCLES] : 0);
+		for (c = 0; c < _M_PERF_MAX; ++c) {
+			if (!(valid & (1UL << c)))
+				continue;
+			if (perf->valid & (1UL << c))
+				fprintf(stdout, " %10.1f",
+					(double)perf->count[c] / iter);
+			else
+				fprintf(stdout, " %10s", "-");
+		}
+		fputc('\n', stdout);
+	}
+}
 
 /**
  * It prints a summary of all executed test.
@@ -869,27 +4861,75 @@ static void m_suite_init(struct m_suite *suite)
  */
 static void m_suite_summary(struct m_suite *m_suite)
 {
-	fputs("Success     Fail    Skip  |   Total", stdout);
-	fprintf(stdout, "% 7u  % 7u % 7u  | % 7u\n",
+	fputs("Success     Fail    Skip  Regress  Timeout   Cached  Cancelled  |   Total\n",
+	      stdout);
+	fprintf(stdout, "%7u  %7u %7u  %7u  %7u  %7u  %9u  | %7u\n",
 		m_suite->success_count,
 		m_suite->fail_count,
 		m_suite->skip_count,
+		m_suite->regression_count,
+		m_suite->timeout_count,
+		m_suite->cached_count,
+		m_suite->cancelled_count,
 		m_suite->total_count);
 
+	m_suite_summary_slowest(m_suite);
+	if (m_suite->flags & M_PERF)
+		m_suite_summary_perf(m_suite);
+
 	/* Be sure that the state machine is working */
 	assert(m_suite->success_count +
 	       m_suite->fail_count +
-	       m_suite->skip_count == m_suite->total_count);
+	       m_suite->skip_count +
+	       m_suite->regression_count +
+	       m_suite->timeout_count +
+	       m_suite->cached_count == m_suite->total_count);
+}
+
+
+/**
+ * It counts the tests that should have run but did not, because the
+ * suite stopped early
+ * @param[in] m_suite the suite that just ran
+ */
+static void m_suite_cancelled(struct m_suite *m_suite)
+{
+	unsigned int i;
+
+	for (i = 0; i < m_suite->test_count; ++i)
+		if (m_test_runnable(&m_suite->tests[i]) &&
+		    m_suite->tests[i].exit == M_STATE_EXIT_NORUN)
+			m_count_inc(m_suite->cancelled_count);
 }
 
 
 /**
- * It runs all the tests within the given suite
+ * It runs all the tests within the given suite in a new run context
  * @param[in] m_suite the suite to run
+ * @param[in] pool worker pool to use, NULL to run serially
  */
-void m_suite_run(struct m_suite *m_suite)
+static void m_suite_run_ctx(struct m_suite *m_suite, struct m_pool *pool)
 {
+	struct m_status ctx, *prv = status;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.pool = pool;
+	status = &ctx;
+
 	m_suite_init(m_suite);
+	if (m_suite->baseline && (m_suite->flags & M_BASELINE_SAVE))
+		m_baseline_reset(m_suite);
+	else if (m_suite->baseline)
+		ctx.baseline = m_baseline_load(m_suite);
+	if (m_suite->cache)
+		m_cache_load(m_suite);
+	if (m_suite->last_run)
+		m_last_run_order(m_suite);
+	if (pool && m_pool_plan(pool, m_suite) < 0) {
+		fprintf(stdout, "Cannot plan worker pool: %s. Run serially\n",
+			strerror(errno));
+		ctx.pool = NULL;
+	}
 
 	if (m_suite->flags & M_VERBOSE) {
 		fprintf(stdout, "Running suite \"%s\"\n", m_suite->name);
@@ -900,13 +4940,148 @@ void m_suite_run(struct m_suite *m_suite)
 		}
 	}
 
-	m_suite_run_state_machine(m_suite);
+	m_signal_install();
+	m_suite_run_state_machine(m_suite, M_STATE_SUITE_SET_UP);
+	m_signal_uninstall();
+	m_suite_cancelled(m_suite);
+
+	if (m_suite->history)
+		m_history_save(m_suite);
+	if (m_suite->cache)
+		m_cache_save(m_suite);
+	if (m_suite->last_run)
+		m_last_run_save(m_suite);
 
 	if (m_suite->flags & M_VERBOSE) {
 		fputs("------------------------------------------\n", stdout);
 		m_suite_summary(m_suite);
 		fputs("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n", stdout);
 	}
+
+	m_perf_close();
+	m_baseline_free(ctx.baseline, m_suite->test_count);
+	free(ctx.order);
+	free(ctx.prio);
+	if (ctx.out.f)
+		fclose(ctx.out.f);
+	status = prv;
+}
+
+
+/**
+ * It runs all the tests within the given suite in a pool of processes
+ * @param[in] m_suite the suite to run
+ * @param[in] nworkers number of workers
+ */
+static void m_suite_run_pool(struct m_suite *m_suite, unsigned int nworkers)
+{
+	struct m_pool *pool;
+
+	pool = m_pool_create(m_suite, nworkers);
+	if (!pool) {
+		fprintf(stdout, "Cannot create worker pool: %s. Run serially\n",
+			strerror(errno));
+		m_suite_run_ctx(m_suite, NULL);
+		return;
+	}
+
+	m_suite_run_ctx(m_suite, pool);
+
+	m_pool_destroy(pool);
+}
+
+
+/**
+ * It runs all the tests within the given suite.
+ * It is safe to run different suites from different threads at the
+ * same time. With M_ISOLATE, the suite set_up() runs once and the tests
+ * run in a child process forked from the set up environment
+ * @param[in] m_suite the suite to run
+ */
+void m_suite_run(struct m_suite *m_suite)
+{
+	if ((m_suite->flags & M_ISOLATE) && m_suite->test_count)
+		m_suite_run_pool(m_suite, 1);
+	else
+		m_suite_run_ctx(m_suite, NULL);
+}
+
+
+/**
+ * It runs all the tests within the given suite using a pool of
+ * processes. The suite set_up() and tear_down() run only once in the
+ * calling process; workers inherit the suite environment by fork().
+ * Tests are handed out dynamically to the first idle worker.
+ * With M_ISOLATE, workers are replaced after each test, or every
+ * m_suite->isolate_batch tests.
+ * @param[in] m_suite the suite to run
+ * @param[in] nworkers number of workers, 0 to use one worker per
+ *            online CPU
+ */
+void m_suite_run_parallel(struct m_suite *m_suite, unsigned int nworkers)
+{
+	if (!nworkers) {
+		long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+		nworkers = ncpu > 0 ? ncpu : 1;
+	}
+	if (nworkers > m_suite->test_count)
+		nworkers = m_suite->test_count;
+	if (nworkers <= 1) {
+		m_suite_run(m_suite);
+		return;
+	}
+
+	m_suite_run_pool(m_suite, nworkers);
+}
+
+
+/**
+ * It tears down the environment kept by the runs of a M_KEEP_SET_UP
+ * suite, by running its tear_down() on it. It runs outside of any suite
+ * run, so tear_down() must not use assertions or checks
+ * @param[in] m_suite the suite to release
+ */
+void m_suite_release(struct m_suite *m_suite)
+{
+	struct m_kept *kept;
+
+	if (!m_suite->name)
+		return;
+	while ((kept = m_kept_take(m_suite->name))) {
+		m_suite->private = kept->private;
+		if (m_suite->tear_down)
+			m_suite->tear_down(m_suite);
+		free(kept->name);
+		free(kept);
+	}
+	m_suite->private = NULL;
+}
+
+
+/**
+ * It gets the environment kept by the runs of a M_KEEP_SET_UP suite,
+ * without taking it
+ * @param[in] m_suite the suite
+ * @return the kept m_suite->private, NULL if there is none
+ */
+void *m_suite_kept(const struct m_suite *m_suite)
+{
+	struct m_kept *kept;
+	void *private = NULL;
+
+	if (!m_suite->name)
+		return NULL;
+	m_kept_lock_get();
+	for (kept = m_kept_list; kept; kept = kept->next) {
+		if (strcmp(kept->name, m_suite->name))
+			continue;
+		private = kept->private;
+		break;
+	}
+	m_kept_lock_put();
+
+	return private;
 }
 
 
@@ -926,3 +5101,627 @@ void m_test_run(struct m_test *m_test)
 
 	m_suite_run(&m_suite);
 }
+
+
+/* -------------------------------------------------------------------- */
+/*                         Command Line Driver                          */
+/* -------------------------------------------------------------------- */
+
+/**
+ * Test selection of a m_main() run
+ */
+struct m_filter {
+	const char **suites; /**< suite name patterns, any must match */
+	unsigned int suite_count; /**< number of suite name patterns */
+	const char **tests; /**< test description patterns, any must match */
+	unsigned int test_count; /**< number of test description patterns */
+	regex_t *suites_re; /**< compiled suite patterns (--regex) */
+	regex_t *tests_re; /**< compiled test patterns (--regex) */
+	unsigned int shard; /**< shard to run */
+	unsigned int shard_count; /**< number of shards, 0 for no sharding */
+};
+
+static void m_main_usage(const char *prog)
+{
+	fprintf(stdout,
+		"Usage: %s [options]\n"
+		"  -s, --suite=PATTERN  run the suites whose name matches PATTERN\n"
+		"  -t, --test=PATTERN   run the tests whose description matches PATTERN\n"
+		"  -E, --regex          patterns are extended regular expressions,\n"
+		"                       shell wildcards otherwise\n"
+		"  -l, --list           list the selected tests, do not run them\n"
+		"  -r, --repeat=N       run the selected tests N times\n"
+		"      --shard=I/N      run only the I-th (0 based) of N shards\n"
+		"  -j, --jobs=N         run each suite in N processes, 0 for one\n"
+		"                       per CPU\n"
+		"  -c, --cache=FILE     skip the tests that succeeded with the same\n"
+		"                       code, according to FILE\n"
+		"  -f, --force          run also the tests in the cache\n"
+		"  -F, --failed-first=FILE  run first the tests that failed in the\n"
+		"                       last run, according to FILE\n"
+		"  -x, --fail-fast      stop at the first failure\n"
+		"      --max-failures=N stop after N failures\n"
+		"  -v, --verbose        verbose output\n"
+		"  -h, --help           this help\n"
+		"Patterns can be given more than once.\n", prog);
+}
+
+/**
+ * It tells if a string matches any of the given patterns
+ * @param[in] str string to match
+ * @param[in] pat shell wildcard patterns
+ * @param[in] re compiled regular expressions, NULL to use pat
+ * @param[in] n number of patterns, 0 matches everything
+ * @return 1 when it matches, 0 otherwise
+ */
+static int m_filter_match(const char *str, const char **pat, regex_t *re,
+			  unsigned int n)
+{
+	unsigned int i;
+
+	if (!n)
+		return 1;
+	if (!str)
+		str = "";
+	for (i = 0; i < n; ++i) {
+		if (re && !regexec(&re[i], str, 0, NULL, 0))
+			return 1;
+		if (!re && !fnmatch(pat[i], str, 0))
+			return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * It returns the shard of a test. The shard depends only on the suite
+ * name and on the test description (index, if there is none), so adding
+ * or removing tests does not move the others to a different shard
+ * @param[in] m_suite the suite the test belongs to
+ * @param[in] index test index
+ * @param[in] n number of shards
+ * @return the test's shard
+ */
+static unsigned int m_filter_shard(struct m_suite *m_suite,
+				   unsigned int index, unsigned int n)
+{
+	const char *desc = m_suite->tests[index].desc;
+	uint64_t key;
+
+	key = m_hash_str(m_suite->name ? m_suite->name : "") * 31;
+	key += desc ? m_hash_str(desc) : index;
+	/* Mix the bits, FNV low bits are weak for small moduli */
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+
+	return key % n;
+}
+
+/**
+ * It applies the filters to a suite: tests not selected are disabled
+ * @param[in] m_suite the suite to filter
+ * @param[in] f test selection
+ * @return the number of selected tests
+ */
+static unsigned int m_filter_apply(struct m_suite *m_suite,
+				   struct m_filter *f)
+{
+	unsigned int i, n = 0;
+	int suite_match;
+
+	suite_match = m_filter_match(m_suite->name, f->suites, f->suites_re,
+				     f->suite_count);
+	for (i = 0; i < m_suite->test_count; ++i) {
+		struct m_test *m_test = &m_suite->tests[i];
+
+		if (!suite_match || (m_test->flags & M_TEST_DISABLED) ||
+		    !m_filter_match(m_test->desc, f->tests, f->tests_re,
+				    f->test_count) ||
+		    (f->shard_count &&
+		     m_filter_shard(m_suite, i, f->shard_count) != f->shard)) {
+			m_test->flags |= M_TEST_DISABLED;
+			continue;
+		}
+		n++;
+	}
+
+	return n;
+}
+
+/**
+ * It returns the number of tests of a suite selected by the filters. The
+ * exit of the previous run (e.g. cached) does not matter
+ * @param[in] m_suite the suite
+ * @return the number of selected tests
+ */
+static unsigned int m_filter_selected(struct m_suite *m_suite)
+{
+	unsigned int i, n = 0;
+
+	for (i = 0; i < m_suite->test_count; ++i)
+		if (!(m_suite->tests[i].flags & M_TEST_DISABLED))
+			n++;
+
+	return n;
+}
+
+/**
+ * It compiles the patterns as extended regular expressions
+ * @param[in] pat patterns
+ * @param[in] n number of patterns
+ * @return the compiled patterns, NULL on error
+ */
+static regex_t *m_filter_compile(const char **pat, unsigned int n)
+{
+	regex_t *re;
+	unsigned int i;
+	char err[128];
+	int ret;
+
+	re = calloc(n ? n : 1, sizeof(*re));
+	if (!re)
+		return NULL;
+	for (i = 0; i < n; ++i) {
+		ret = regcomp(&re[i], pat[i], REG_EXTENDED | REG_NOSUB);
+		if (!ret)
+			continue;
+		regerror(ret, &re[i], err, sizeof(err));
+		fprintf(stdout, "Invalid pattern \"%s\": %s\n", pat[i], err);
+		while (i--)
+			regfree(&re[i]);
+		free(re);
+		return NULL;
+	}
+
+	return re;
+}
+
+static void m_filter_free(struct m_filter *f)
+{
+	unsigned int i;
+
+	if (f->suites_re)
+		for (i = 0; i < f->suite_count; ++i)
+			regfree(&f->suites_re[i]);
+	if (f->tests_re)
+		for (i = 0; i < f->test_count; ++i)
+			regfree(&f->tests_re[i]);
+	free(f->suites_re);
+	free(f->tests_re);
+	free(f->suites);
+	free(f->tests);
+}
+
+
+/**
+ * Suite settings that a m_main() run changes, to give them back to the
+ * caller
+ */
+struct m_main_saved {
+	unsigned long flags;
+	unsigned int fail_budget;
+	const char *cache;
+	const char *last_run;
+	unsigned long *test_flags;
+};
+
+/**
+ * It saves the suite and test settings changed by a m_main() run
+ * @param[in] suites test suites of the program
+ * @param[in] n number of test suites
+ * @return the saved settings, NULL on error
+ */
+static struct m_main_saved *m_main_save(struct m_suite *suites[],
+					unsigned int n)
+{
+	struct m_main_saved *saved;
+	unsigned long *flags;
+	unsigned int i, j, count = 0;
+
+	for (i = 0; i < n; ++i)
+		count += suites[i]->test_count;
+	saved = malloc(n * sizeof(*saved) + count * sizeof(*flags) + 1);
+	if (!saved)
+		return NULL;
+	flags = (unsigned long *)(saved + n);
+	for (i = 0; i < n; ++i) {
+		saved[i].flags = suites[i]->flags;
+		saved[i].fail_budget = suites[i]->fail_budget;
+		saved[i].cache = suites[i]->cache;
+		saved[i].last_run = suites[i]->last_run;
+		saved[i].test_flags = flags;
+		for (j = 0; j < suites[i]->test_count; ++j)
+			*flags++ = suites[i]->tests[j].flags;
+	}
+
+	return saved;
+}
+
+/**
+ * It restores the suite and test settings as they were before a m_main()
+ * run, so that the next run starts from the same selection. The results
+ * of the run are left in place
+ * @param[in] suites test suites of the program
+ * @param[in] n number of test suites
+ * @param[in] saved settings from m_main_save(), released here
+ */
+static void m_main_restore(struct m_suite *suites[], unsigned int n,
+			   struct m_main_saved *saved)
+{
+	unsigned int i, j;
+
+	if (!saved)
+		return;
+	for (i = 0; i < n; ++i) {
+		suites[i]->flags = saved[i].flags;
+		suites[i]->fail_budget = saved[i].fail_budget;
+		suites[i]->cache = saved[i].cache;
+		suites[i]->last_run = saved[i].last_run;
+		for (j = 0; j < suites[i]->test_count; ++j)
+			suites[i]->tests[j].flags = saved[i].test_flags[j];
+	}
+	free(saved);
+}
+
+/**
+ * It parses the number of a command line option
+ * @param[in] name option name, for the error message
+ * @param[in] arg option argument
+ * @param[in] max maximum valid value
+ * @param[out] val parsed number
+ * @return 0 on success, -1 when the argument is not a valid number
+ */
+static int m_main_number(const char *name, const char *arg,
+			 unsigned long max, unsigned long *val)
+{
+	char *end;
+
+	errno = 0;
+	*val = strtoul(arg, &end, 0);
+	if (!isdigit((unsigned char)*arg) || *end || errno || *val > max) {
+		fprintf(stdout, "Invalid --%s value \"%s\"\n", name, arg);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Command line driver for test programs. It selects the tests to run
+ * according to the command line options (run the program with --help
+ * to list them) and it runs them.
+ * Tests that are not selected get the M_TEST_DISABLED flag during the run.
+ * When it returns, suites and tests have the flags and settings they had
+ * before, only the results of the run are left
+ * @param[in] argc number of command line arguments
+ * @param[in] argv command line arguments
+ * @param[in] suites test suites of the program
+ * @param[in] n number of test suites
+ * @return EXIT_SUCCESS when all the selected tests succeed, EXIT_FAILURE
+ *         otherwise
+ */
+int m_main(int argc, char *argv[], struct m_suite *suites[], unsigned int n)
+{
+	static const struct option opts[] = {
+		{"suite", required_argument, NULL, 's'},
+		{"test", required_argument, NULL, 't'},
+		{"regex", no_argument, NULL, 'E'},
+		{"list", no_argument, NULL, 'l'},
+		{"repeat", required_argument, NULL, 'r'},
+		{"shard", required_argument, NULL, 'S'},
+		{"jobs", required_argument, NULL, 'j'},
+		{"cache", required_argument, NULL, 'c'},
+		{"force", no_argument, NULL, 'f'},
+		{"failed-first", required_argument, NULL, 'F'},
+		{"fail-fast", no_argument, NULL, 'x'},
+		{"max-failures", required_argument, NULL, 'M'},
+		{"verbose", no_argument, NULL, 'v'},
+		{"help", no_argument, NULL, 'h'},
+		{NULL, 0, NULL, 0},
+	};
+	struct m_filter f;
+	struct m_main_saved *saved = NULL;
+	unsigned int i, j, failures = 0, total = 0, cancelled = 0;
+	unsigned long repeat = 1, budget = 0, val;
+	int opt, regex = 0, list = 0, jobs = -1;
+	const char *cache = NULL, *last_run = NULL;
+	unsigned long flags = 0;
+	int ret = EXIT_FAILURE;
+
+	memset(&f, 0, sizeof(f));
+	f.suites = calloc(argc, sizeof(*f.suites));
+	f.tests = calloc(argc, sizeof(*f.tests));
+	if (!f.suites || !f.tests)
+		goto out;
+
+	optind = 1;
+	while ((opt = getopt_long(argc, argv, "s:t:Elr:j:c:fF:xvh",
+				  opts, NULL)) != -1) {
+		switch (opt) {
+		case 's':
+			f.suites[f.suite_count++] = optarg;
+			break;
+		case 't':
+			f.tests[f.test_count++] = optarg;
+			break;
+		case 'E':
+			regex = 1;
+			break;
+		case 'l':
+			list = 1;
+			break;
+		case 'r':
+			if (m_main_number("repeat", optarg, UINT_MAX, &repeat))
+				goto usage;
+			break;
+		case 'S':
+			if (sscanf(optarg, "%u/%u", &f.shard,
+				   &f.shard_count) != 2 ||
+			    f.shard >= f.shard_count) {
+				fprintf(stdout, "Invalid shard \"%s\"\n", optarg);
+				goto out;
+			}
+			break;
+		case 'j':
+			if (m_main_number("jobs", optarg, INT_MAX, &val))
+				goto usage;
+			jobs = val;
+			break;
+		case 'c':
+			cache = optarg;
+			break;
+		case 'f':
+			flags |= M_CACHE_FORCE;
+			break;
+		case 'F':
+			last_run = optarg;
+			break;
+		case 'x':
+			budget = 1;
+			break;
+		case 'M':
+			if (m_main_number("max-failures", optarg, UINT_MAX,
+					  &budget))
+				goto usage;
+			break;
+		case 'v':
+			flags |= M_VERBOSE;
+			break;
+		case 'h':
+			m_main_usage(argv[0]);
+			ret = EXIT_SUCCESS;
+			goto out;
+		default:
+			goto usage;
+		}
+	}
+
+	if (regex) {
+		f.suites_re = m_filter_compile(f.suites, f.suite_count);
+		f.tests_re = m_filter_compile(f.tests, f.test_count);
+		if (!f.suites_re || !f.tests_re)
+			goto out;
+	}
+
+	saved = m_main_save(suites, n);
+	if (!saved)
+		goto out;
+	for (i = 0; i < n; ++i) {
+		if (!m_filter_apply(suites[i], &f) || !list)
+			continue;
+		for (j = 0; j < suites[i]->test_count; ++j)
+			if (!(suites[i]->tests[j].flags & M_TEST_DISABLED))
+				fprintf(stdout, "%s:%u %s\n", suites[i]->name, j,
+					suites[i]->tests[j].desc ?
+					suites[i]->tests[j].desc : "");
+	}
+	if (list) {
+		ret = EXIT_SUCCESS;
+		goto out;
+	}
+
+	while (repeat-- && (!budget || failures < budget)) {
+		for (i = 0; i < n && (!budget || failures < budget); ++i) {
+			struct m_suite *m_suite = suites[i];
+
+			if (!m_filter_selected(m_suite))
+				continue;
+			if (budget)
+				m_suite->fail_budget = budget - failures;
+			if (cache && !m_suite->cache)
+				m_suite->cache = cache;
+			if (last_run && !m_suite->last_run)
+				m_suite->last_run = last_run;
+			m_suite->flags |= flags;
+			if (jobs < 0)
+				m_suite_run(m_suite);
+			else
+				m_suite_run_parallel(m_suite, jobs);
+			fprintf(stdout, "Suite \"%s\": %u success, %u fail, %u skip, %u regress, %u timeout, %u cached, %u cancelled\n",
+				m_suite->name, m_suite->success_count,
+				m_suite->fail_count, m_suite->skip_count,
+				m_suite->regression_count,
+				m_suite->timeout_count,
+				m_suite->cached_count,
+				m_suite->cancelled_count);
+			failures += m_suite->fail_count +
+				    m_suite->regression_count +
+				    m_suite->timeout_count;
+			total += m_suite->total_count;
+			cancelled += m_suite->cancelled_count;
+		}
+	}
+	/* The suites left behind by the budget do not run at all */
+	for (; budget && failures >= budget && i < n; ++i)
+		cancelled += m_filter_selected(suites[i]);
+	fprintf(stdout, "Total: %u tests, %u failures\n", total, failures);
+	if (cancelled && budget && failures >= budget)
+		fprintf(stdout, "Stopped after %u failures, %u tests not run\n",
+			failures, cancelled);
+	else if (cancelled)
+		fprintf(stdout, "%u tests not run\n", cancelled);
+	ret = failures ? EXIT_FAILURE : EXIT_SUCCESS;
+	goto out;
+
+usage:
+	m_main_usage(argv[0]);
+out:
+	m_main_restore(suites, n, saved);
+	m_filter_free(&f);
+	return ret;
+}
+
+
+static int m_test_line_cmp(const void *a, const void *b)
+{
+	const struct m_test *ta = a, *tb = b;
+
+	return ta->line < tb->line ? -1 : ta->line > tb->line;
+}
+
+static int m_test_reg_cmp(const void *a, const void *b)
+{
+	const struct m_test *ta = a, *tb = b;
+	int ret;
+
+	ret = strcmp(ta->suite_name, tb->suite_name);
+	if (!ret && ta->file != tb->file)
+		ret = strcmp(ta->file, tb->file);
+	if (!ret)
+		ret = m_test_line_cmp(a, b);
+
+	return ret;
+}
+
+/**
+ * It tells if the tests of a suite are not all together, which happens
+ * when the suite is spread among several source files. The names of the
+ * groups of consecutive tests go in a hash set: a name found twice is a
+ * split suite
+ * @param[in] tests registered tests
+ * @param[in] n number of tests
+ * @return 1 when a suite name appears in more than one group of tests
+ */
+static int m_registered_split(const struct m_test *tests, unsigned int n)
+{
+	unsigned int i, groups = 0, size = 1, slot;
+
+	for (i = 0; i < n; ++i)
+		if (!i || strcmp(tests[i - 1].suite_name, tests[i].suite_name))
+			groups++;
+	while (size < 2 * groups)
+		size <<= 1;
+
+	{
+		const char *seen[size];
+
+		memset(seen, 0, sizeof(seen));
+		for (i = 0; i < n; ++i) {
+			if (i && !strcmp(tests[i - 1].suite_name,
+					 tests[i].suite_name))
+				continue;
+			slot = m_hash_str(tests[i].suite_name) & (size - 1);
+			for (; seen[slot]; slot = (slot + 1) & (size - 1))
+				if (!strcmp(seen[slot], tests[i].suite_name))
+					return 1;
+			seen[slot] = tests[i].suite_name;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * It puts a group of registered tests in definition order (source file,
+ * then line). Compilers emit them either in definition order or in the
+ * reverse one, both cases are handled in linear time
+ * @param[in] tests registered tests of a suite
+ * @param[in] n number of tests
+ */
+static void m_registered_sort(struct m_test *tests, unsigned int n)
+{
+	unsigned int i, up = 1, down = 1;
+	struct m_test tmp;
+
+	for (i = 1; i < n; ++i) {
+		int cmp = m_test_reg_cmp(&tests[i - 1], &tests[i]);
+
+		up &= cmp <= 0;
+		down &= cmp >= 0;
+	}
+	if (up)
+		return;
+	if (!down) {
+		qsort(tests, n, sizeof(*tests), m_test_reg_cmp);
+		return;
+	}
+	for (i = 0; i < n / 2; ++i) {
+		tmp = tests[i];
+		tests[i] = tests[n - 1 - i];
+		tests[n - 1 - i] = tmp;
+	}
+}
+
+/**
+ * It groups the tests registered with M_TEST() in suites. Tests with the
+ * same suite name make one suite, even when it is spread among several
+ * source files: then the tests are sorted first to bring them together,
+ * so suite names stay unique in the history, the cache and the kept
+ * set_up environments. Call it first without suites to get how many
+ * suites are needed
+ * @param[in] start first registered test
+ * @param[in] stop one past the last registered test
+ * @param[out] suites suites to fill (zeroed by the caller), NULL to
+ *             count them only
+ * @return the number of suites
+ */
+unsigned int m_registered_suites(struct m_test *start, struct m_test *stop,
+				 struct m_suite *suites)
+{
+	unsigned int i, n = 0, count = start ? stop - start : 0;
+
+	if (m_registered_split(start, count))
+		qsort(start, count, sizeof(*start), m_test_reg_cmp);
+	for (i = 0; i < count; ++i) {
+		if (!i || strcmp(start[i - 1].suite_name,
+				 start[i].suite_name)) {
+			if (suites) {
+				suites[n].name = start[i].suite_name;
+				suites[n].tests = &start[i];
+			}
+			n++;
+		}
+		if (suites)
+			suites[n - 1].test_count++;
+	}
+	if (suites)
+		for (i = 0; i < n; ++i)
+			m_registered_sort(suites[i].tests, suites[i].test_count);
+
+	return n;
+}
+
+/**
+ * Command line driver for tests registered with M_TEST(); use it through
+ * m_main_registered(). Suites live on the stack: there is no heap
+ * allocation and no work proportional to more than the number of tests
+ * @param[in] argc number of command line arguments
+ * @param[in] argv command line arguments
+ * @param[in] start first registered test
+ * @param[in] stop one past the last registered test
+ * @return the m_main() exit status
+ */
+int m_main_tests(int argc, char *argv[],
+		 struct m_test *start, struct m_test *stop)
+{
+	unsigned int i, n = m_registered_suites(start, stop, NULL);
+	struct m_suite suites[n ? n : 1], *ptrs[n ? n : 1];
+
+	memset(suites, 0, sizeof(suites));
+	m_registered_suites(start, stop, suites);
+	for (i = 0; i < n; ++i)
+		ptrs[i] = &suites[i];
+
+	return m_main(argc, argv, ptrs, n);
+}
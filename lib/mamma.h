@@ -8,6 +8,8 @@
 
 #include <errno.h>
 #include <setjmp.h>
+#include <stdint.h>
+#include <string.h>
 
 /**
  * It computes the given array size
@@ -57,6 +59,34 @@ enum m_asserts {
 	M_MEM_LE,
 	M_ERR_EQ,
 	M_ERR_NEQ,
+	M_I64_EQ,
+	M_I64_NEQ,
+	M_I64_RANGE,
+	M_I64_NRANGE,
+	M_I64_GT,
+	M_I64_GE,
+	M_I64_LT,
+	M_I64_LE,
+	M_U64_EQ,
+	M_U64_NEQ,
+	M_U64_RANGE,
+	M_U64_NRANGE,
+	M_U64_GT,
+	M_U64_GE,
+	M_U64_LT,
+	M_U64_LE,
+	M_SIZE_EQ,
+	M_SIZE_NEQ,
+	M_SIZE_RANGE,
+	M_SIZE_NRANGE,
+	M_SIZE_GT,
+	M_SIZE_GE,
+	M_SIZE_LT,
+	M_SIZE_LE,
+	M_INT_ARRAY_EQ,
+	M_INT_ARRAY_RANGE,
+	M_INT_ARRAY_SORTED,
+	M_DBL_ARRAY_NEAR,
 	__M_MAX_STANDARD_ASSERTION,
 };
 
@@ -82,6 +112,9 @@ enum m_state_machine_test_exit_cause {
 	M_STATE_EXIT_SUCCESS,
 	M_STATE_EXIT_SKIP,
 	M_STATE_EXIT_ERROR,
+	M_STATE_EXIT_REGRESSION, /**< benchmark slower than its baseline */
+	M_STATE_EXIT_TIMEOUT, /**< set_up() and test() lasted too long */
+	M_STATE_EXIT_CACHED, /**< not run, it succeeded with the same code */
 };
 
 /**
@@ -95,6 +128,79 @@ enum m_state_machine_test_exit_cause {
 #define M_FLAG_STOP_ON_ERROR (1 << 0)
 
 
+/**
+ * Time spent by a test phase
+ */
+struct m_time {
+	uint64_t wall; /**< monotonic wall-clock time (ns) */
+	uint64_t cpu; /**< CPU time used by the running thread (ns), with
+			 M_CPU_TIME */
+};
+
+/**
+ * Performance counters measured around each test body when the suite
+ * runs with M_PERF
+ */
+enum m_perf_counter {
+	M_PERF_CYCLES = 0,
+	M_PERF_INSTRUCTIONS,
+	M_PERF_BRANCH_MISSES,
+	M_PERF_L1D_MISSES,
+	M_PERF_LLC_MISSES,
+	M_PERF_DTLB_MISSES,
+	/* Software fallback */
+	M_PERF_TASK_CLOCK,
+	M_PERF_CONTEXT_SWITCHES,
+	M_PERF_PAGE_FAULTS,
+	_M_PERF_MAX,
+};
+
+/**
+ * Performance counters of a test body, all iterations
+ */
+struct m_perf {
+	uint64_t count[_M_PERF_MAX]; /**< counter values */
+	unsigned long valid; /**< mask of the counters that have been measured */
+	uint64_t iterations; /**< number of test body iterations */
+};
+
+/**
+ * Benchmark statistics, all times are per iteration in nanoseconds
+ */
+struct m_bench_stats {
+	unsigned int samples; /**< number of samples */
+	unsigned long batch; /**< iterations per sample */
+	double min; /**< fastest sample */
+	double max; /**< slowest sample */
+	double median; /**< median sample */
+	double mean; /**< arithmetic mean */
+	double stddev; /**< sample standard deviation */
+	double p99; /**< 99th percentile */
+	double baseline; /**< baseline median, 0 when not compared */
+};
+
+/**
+ * The test is a benchmark: each iteration is timed on its own and
+ * statistics are collected in m_test->bench
+ */
+#define M_TEST_BENCH (1 << 0)
+
+/**
+ * The benchmark looks for the number of iterations per sample that makes
+ * the measurement last m_suite->bench_ns
+ */
+#define M_TEST_CALIBRATE (1 << 1)
+
+/**
+ * The test is not run. m_main() uses it to apply its filters
+ */
+#define M_TEST_DISABLED (1 << 2)
+
+/**
+ * Default number of samples taken by auto-calibrated benchmarks
+ */
+#define M_BENCH_SAMPLES 30
+
 /**
  * Data structure representing a functionality test
  */
@@ -113,8 +219,20 @@ struct m_test {
 						   operations done by the
 						   set_up() function */
 	unsigned int loop; /**< number of test repetitions */
+	unsigned long flags; /**< test options */
+	unsigned long timeout_ms; /**< maximum duration of set_up() and test()
+				     in milliseconds, 0 for the suite
+				     default */
+	const char *suite_name; /**< suite of a registered test (M_TEST) */
+	const char *file; /**< source file of a registered test (M_TEST) */
+	unsigned int line; /**< source line of a registered test (M_TEST) */
 	enum m_state_machine_test_exit_cause exit;
 	unsigned int warnings;
+	struct m_time time_set_up; /**< time spent in set_up() */
+	struct m_time time_test; /**< time spent in test(), all iterations */
+	struct m_time time_tear_down; /**< time spent in tear_down() */
+	struct m_bench_stats bench; /**< benchmark statistics */
+	struct m_perf perf; /**< performance counters (M_PERF) */
 };
 
 /**
@@ -176,6 +294,109 @@ struct m_test {
 			.loop = (_loop),        \
 			}
 
+/**
+ * It declare a test with a timeout. When set_up() and test() last longer
+ * than _timeout_ms, the test is stopped and counted as timed out
+ * @param[in] _up set_up function to assign
+ * @param[in] _test test function to assign
+ * @param[in] _down tear_down function to assign
+ * @param[in] _desc test description
+ * @param[in] _timeout_ms timeout in milliseconds
+ */
+#define m_test_desc_timeout(_up, _test, _down, _desc, _timeout_ms) {\
+			.desc = (_desc),        \
+			.set_up = (_up),        \
+			.test = (_test),        \
+			.tear_down = (_down),   \
+			.loop = 1,              \
+			.timeout_ms = (_timeout_ms), \
+			}
+
+/**
+ * It declares a test function and it registers it in the "m_tests"
+ * section of the program. Registered tests are grouped in suites by
+ * name and m_main_registered() runs them. The macro must be followed by
+ * the function body:
+ *
+ *	M_TEST(math, sum)
+ *	{
+ *		m_assert_int_eq(4, 2 + 2);
+ *	}
+ *
+ * @param[in] _suite suite name, it must be an identifier
+ * @param[in] _name test name, it must be an identifier. It is the test
+ *            description
+ */
+#define M_TEST(_suite, _name)						\
+	static void m_test_##_suite##_##_name(struct m_test *m_test);	\
+	static struct m_test m_test_reg_##_suite##_##_name		\
+	__attribute__((used, section("m_tests"), aligned(sizeof(void *)))) = {\
+		.desc = #_name,						\
+		.test = m_test_##_suite##_##_name,			\
+		.loop = 1,						\
+		.suite_name = #_suite,					\
+		.file = __FILE__,					\
+		.line = __LINE__,					\
+	};								\
+	static void m_test_##_suite##_##_name(struct m_test *m_test)
+
+/**
+ * Boundaries of the registered tests, provided by the linker. They are
+ * weak so that programs without registered tests link anyway
+ */
+extern struct m_test __start_m_tests[] __attribute__((weak));
+extern struct m_test __stop_m_tests[] __attribute__((weak));
+
+/**
+ * It exports the tests registered with M_TEST() by a shared object, so
+ * that mamma-run can find them. Use it once in each test shared object.
+ * Shared objects can export their own suites as well, by defining a NULL
+ * terminated array `struct m_suite *m_suites[]`
+ */
+#define M_TEST_LIBRARY()						\
+	struct m_test *m_library_tests(struct m_test **stop);		\
+	struct m_test *m_library_tests(struct m_test **stop)		\
+	{								\
+		*stop = __stop_m_tests;					\
+		return __start_m_tests;					\
+	}
+
+/**
+ * It declare a benchmark in a shorter way. The test function runs
+ * _loop times and each iteration is timed
+ * @param[in] _up set_up function to assign
+ * @param[in] _test test function to assign
+ * @param[in] _down tear_down function to assign
+ * @param[in] _desc test description
+ * @param[in] _loop test repetitions
+ */
+#define m_bench(_up, _test, _down, _desc, _loop) {\
+			.desc = (_desc),        \
+			.set_up = (_up),        \
+			.test = (_test),        \
+			.tear_down = (_down),   \
+			.loop = (_loop),        \
+			.flags = M_TEST_BENCH,  \
+			}
+
+/**
+ * It declare an auto-calibrated benchmark. The test function runs in
+ * M_BENCH_SAMPLES batches; the batch size grows until the measurement
+ * lasts m_suite->bench_ns (0.5s by default)
+ * @param[in] _up set_up function to assign
+ * @param[in] _test test function to assign
+ * @param[in] _down tear_down function to assign
+ * @param[in] _desc test description
+ */
+#define m_bench_auto(_up, _test, _down, _desc) {\
+			.desc = (_desc),        \
+			.set_up = (_up),        \
+			.test = (_test),        \
+			.tear_down = (_down),   \
+			.loop = M_BENCH_SAMPLES,\
+			.flags = M_TEST_BENCH | M_TEST_CALIBRATE, \
+			}
+
 /**
  * Test suite container. It is a collection of tests
  */
@@ -196,10 +417,52 @@ struct m_suite {
 						       set_up() function */
 	char *(*strerror)(int errnum); /**< function to use to print errno
 					  error messages */
+	unsigned long bench_ns; /**< measurement time of auto-calibrated
+				   benchmarks (ns), 0 for the default */
+	const char *baseline; /**< file with the benchmark samples of a
+				 previous run. Benchmarks significantly
+				 slower than their baseline are reported as
+				 regressions. See M_BASELINE_SAVE */
+	double regression; /**< minimum slowdown of the median to report as
+			      regression (0.05 means 5%), 0 for the default */
+	const char *history; /**< file where to keep the tests duration
+				history. When set, runs update it and
+				parallel runs start the longest tests first */
+	unsigned int isolate_batch; /**< with M_ISOLATE, number of tests run
+				       by each child process before it is
+				       replaced by a fresh one, 0 for the
+				       default of 1, M_ISOLATE_BATCH_ALL
+				       for no limit */
+	unsigned long timeout_ms; /**< default timeout of the suite's tests
+				     in milliseconds, 0 for no timeout */
+	const char *cache; /**< file where to keep the results cache. When
+			      set, tests that succeeded with the same code
+			      are not run again. See M_CACHE_FORCE */
+	const char *last_run; /**< file where to keep the results of the
+				 last run. When set, the tests that failed
+				 last time run first, followed by the new
+				 and changed ones */
+	unsigned int fail_budget; /**< number of failed tests (errors,
+				     timeouts and regressions) after which
+				     the suite stops, 0 for no limit */
+	size_t output_max; /**< maximum output of a test in bytes, messages
+			      beyond it are dropped. 0 for the default
+			      (64 KiB) */
 	unsigned int total_count; /**< total number of executed suite's tests */
 	unsigned int success_count; /**< number of successful suite's tests */
 	unsigned int fail_count; /**< number of failed suite's tests */
 	unsigned int skip_count;  /**< number of skipped suite's tests */
+	unsigned int regression_count; /**< number of suite's benchmarks
+					  slower than their baseline */
+	unsigned int timeout_count; /**< number of suite's tests stopped
+				       by their timeout */
+	unsigned int cached_count; /**< number of suite's tests whose
+				      success has been replayed from the
+				      cache */
+	unsigned int cancelled_count; /**< number of suite's tests that did
+					 not run because the suite stopped
+					 early (failure budget, set_up()
+					 error) */
 };
 
 /**
@@ -237,8 +500,85 @@ struct m_suite {
  */
 #define M_ERRNO_FUNC (1 << 2)
 
+/**
+ * It measures hardware performance counters (cycles, instructions,
+ * branch-misses, L1D/LLC/dTLB misses) around each test body. When they
+ * are not available, it falls back to software events
+ */
+#define M_PERF (1 << 3)
+
+/**
+ * It records the benchmark samples in m_suite->baseline instead of
+ * comparing them with it
+ */
+#define M_BASELINE_SAVE (1 << 4)
+
+/**
+ * It runs the tests in a child process forked after the suite set_up().
+ * A test that crashes the child is reported as an error and a new child
+ * continues with the next test. See m_suite->isolate_batch
+ */
+#define M_ISOLATE (1 << 5)
+
+/**
+ * m_suite->isolate_batch value that keeps a child running tests until
+ * one of them crashes it
+ */
+#define M_ISOLATE_BATCH_ALL (~0U)
+
+/**
+ * The suite environment built by set_up() is kept when the suite ends:
+ * tear_down() does not run and the next run of a suite with the same
+ * name reuses m_suite->private instead of running set_up() again. This
+ * holds also for a suite of a reloaded shared object (mamma-run --watch),
+ * so the kept data must not reference the shared object: the reloaded
+ * code cannot use it. mamma-run tears down with the old code the kept
+ * environments that point into the object before reloading it, other
+ * references cannot be detected.
+ * m_suite_release() tears the kept environment down
+ */
+#define M_KEEP_SET_UP (1 << 6)
+
+/**
+ * It runs also the tests whose success is in m_suite->cache. The cache
+ * is updated with the new results
+ */
+#define M_CACHE_FORCE (1 << 7)
+
+/**
+ * It stops the suite at the first failed test (error, timeout or
+ * regression), like m_suite->fail_budget = 1
+ */
+#define M_FAIL_FAST (1 << 8)
+
+/**
+ * It measures also the CPU time of the test phases (the cpu field of
+ * m_test->time_set_up, time_test and time_tear_down), which costs a
+ * system call per phase. M_VERBOSE implies it
+ */
+#define M_CPU_TIME (1 << 9)
+
 extern void m_test_run(struct m_test *m_test);
 extern void m_suite_run(struct m_suite *m_suite);
+extern void m_suite_run_parallel(struct m_suite *m_suite, unsigned int nworkers);
+extern void m_suite_release(struct m_suite *m_suite);
+extern void *m_suite_kept(const struct m_suite *m_suite);
+extern int m_main(int argc, char *argv[], struct m_suite *suites[],
+		  unsigned int n);
+extern int m_main_tests(int argc, char *argv[],
+			struct m_test *start, struct m_test *stop);
+extern unsigned int m_registered_suites(struct m_test *start,
+					struct m_test *stop,
+					struct m_suite *suites);
+
+/**
+ * It runs the tests registered with M_TEST() through m_main().
+ * The section boundaries are resolved in the program, not in the library
+ * @param[in] _argc number of command line arguments
+ * @param[in] _argv command line arguments
+ */
+#define m_main_registered(_argc, _argv)				\
+	m_main_tests((_argc), (_argv), __start_m_tests, __stop_m_tests)
 extern void m_skip_test(unsigned int cond,
 			 const char *func, const unsigned int line);
 
@@ -248,9 +588,393 @@ extern void m_skip_test(unsigned int cond,
  */
 #define m_skip(_cond) m_skip_test((_cond), __func__, __LINE__)
 
+/*
+ * Assertions, checks and m_skip() act on the test running in the calling
+ * thread. In a thread spawned by the test there is no such test: a failed
+ * assertion or check is printed, but it does not stop the test and it
+ * does not count as a failure or a warning, and m_skip() does nothing.
+ * Collect the results in the test thread when they matter.
+ */
 extern void m_check(enum m_asserts type, unsigned long flags,
 		    const char *func, const unsigned int line,
 		    ...);
+extern void m_check_failed(enum m_asserts type, unsigned long flags,
+			   const char *func, const unsigned int line,
+			   ...) __attribute__((cold, noinline));
+extern void m_check_array_int_eq(unsigned long flags, const char *func,
+				 const unsigned int line, const int *exp,
+				 const int *val, size_t n);
+extern void m_check_array_int_range(unsigned long flags, const char *func,
+				    const unsigned int line, int min, int max,
+				    const int *val, size_t n);
+extern void m_check_array_int_sorted(unsigned long flags, const char *func,
+				     const unsigned int line, const int *val,
+				     size_t n);
+extern void m_check_array_dbl_near(unsigned long flags, const char *func,
+				   const unsigned int line, const double *exp,
+				   const double *val, size_t n,
+				   double abs_tol, double rel_tol);
+
+
+/*
+ * Fast-path assertions.
+ * The assertion and check macros evaluate their condition inline: the
+ * assertion type is a constant, so each switch below reduces to a single
+ * comparison. The library is called only when the condition is not
+ * satisfied, with the same operands that m_check() would get.
+ */
+#define M_CHECK_INLINE static inline __attribute__((always_inline))
+#define M_LIKELY(_cond) __builtin_expect(!!(_cond), 1)
+
+M_CHECK_INLINE void m_check_fast_bool(enum m_asserts type,
+				      unsigned long flags, const char *func,
+				      const unsigned int line, int a)
+{
+	int cond = (type == M_FALSE) ? !a : !!a;
+
+	if (M_LIKELY(cond))
+		return;
+	m_check_failed(type, flags, func, line, a);
+}
+
+M_CHECK_INLINE void m_check_fast_int(enum m_asserts type,
+				     unsigned long flags, const char *func,
+				     const unsigned int line, int a, int b)
+{
+	int cond;
+
+	switch (type) {
+	case M_INT_EQ:
+	case M_ERR_EQ:
+		cond = (a == b);
+		break;
+	case M_INT_NEQ:
+	case M_ERR_NEQ:
+		cond = (a != b);
+		break;
+	case M_INT_GT:
+		cond = (a > b);
+		break;
+	case M_INT_GE:
+		cond = (a >= b);
+		break;
+	case M_INT_LT:
+		cond = (a < b);
+		break;
+	case M_INT_LE:
+		cond = (a <= b);
+		break;
+	default:
+		cond = 0;
+		break;
+	}
+	if (M_LIKELY(cond))
+		return;
+	m_check_failed(type, flags, func, line, (long)a, (long)b);
+}
+
+M_CHECK_INLINE void m_check_fast_int_range(enum m_asserts type,
+					   unsigned long flags,
+					   const char *func,
+					   const unsigned int line,
+					   int min, int max, int val)
+{
+	int cond = (min <= val && val <= max);
+
+	if (type == M_INT_NRANGE)
+		cond = !cond;
+	if (M_LIKELY(cond))
+		return;
+	m_check_failed(type, flags, func, line, (long)min, (long)max,
+		       (long)val);
+}
+
+M_CHECK_INLINE void m_check_fast_i64(enum m_asserts type,
+				     unsigned long flags, const char *func,
+				     const unsigned int line, int64_t a, int64_t b)
+{
+	int cond;
+
+	switch (type) {
+	case M_I64_EQ:
+		cond = (a == b);
+		break;
+	case M_I64_NEQ:
+		cond = (a != b);
+		break;
+	case M_I64_GT:
+		cond = (a > b);
+		break;
+	case M_I64_GE:
+		cond = (a >= b);
+		break;
+	case M_I64_LT:
+		cond = (a < b);
+		break;
+	case M_I64_LE:
+		cond = (a <= b);
+		break;
+	default:
+		cond = 0;
+		break;
+	}
+	if (M_LIKELY(cond))
+		return;
+	m_check_failed(type, flags, func, line, a, b);
+}
+
+M_CHECK_INLINE void m_check_fast_i64_range(enum m_asserts type,
+					   unsigned long flags,
+					   const char *func,
+					   const unsigned int line,
+					   int64_t min, int64_t max, int64_t val)
+{
+	int cond = (min <= val && val <= max);
+
+	if (type == M_I64_NRANGE)
+		cond = !cond;
+	if (M_LIKELY(cond))
+		return;
+	m_check_failed(type, flags, func, line, min, max, val);
+}
+
+M_CHECK_INLINE void m_check_fast_u64(enum m_asserts type,
+				     unsigned long flags, const char *func,
+				     const unsigned int line, uint64_t a, uint64_t b)
+{
+	int cond;
+
+	switch (type) {
+	case M_U64_EQ:
+		cond = (a == b);
+		break;
+	case M_U64_NEQ:
+		cond = (a != b);
+		break;
+	case M_U64_GT:
+		cond = (a > b);
+		break;
+	case M_U64_GE:
+		cond = (a >= b);
+		break;
+	case M_U64_LT:
+		cond = (a < b);
+		break;
+	case M_U64_LE:
+		cond = (a <= b);
+		break;
+	default:
+		cond = 0;
+		break;
+	}
+	if (M_LIKELY(cond))
+		return;
+	m_check_failed(type, flags, func, line, a, b);
+}
+
+M_CHECK_INLINE void m_check_fast_u64_range(enum m_asserts type,
+					   unsigned long flags,
+					   const char *func,
+					   const unsigned int line,
+					   uint64_t min, uint64_t max, uint64_t val)
+{
+	int cond = (min <= val && val <= max);
+
+	if (type == M_U64_NRANGE)
+		cond = !cond;
+	if (M_LIKELY(cond))
+		return;
+	m_check_failed(type, flags, func, line, min, max, val);
+}
+
+M_CHECK_INLINE void m_check_fast_size(enum m_asserts type,
+				      unsigned long flags, const char *func,
+				      const unsigned int line, size_t a, size_t b)
+{
+	int cond;
+
+	switch (type) {
+	case M_SIZE_EQ:
+		cond = (a == b);
+		break;
+	case M_SIZE_NEQ:
+		cond = (a != b);
+		break;
+	case M_SIZE_GT:
+		cond = (a > b);
+		break;
+	case M_SIZE_GE:
+		cond = (a >= b);
+		break;
+	case M_SIZE_LT:
+		cond = (a < b);
+		break;
+	case M_SIZE_LE:
+		cond = (a <= b);
+		break;
+	default:
+		cond = 0;
+		break;
+	}
+	if (M_LIKELY(cond))
+		return;
+	m_check_failed(type, flags, func, line, a, b);
+}
+
+M_CHECK_INLINE void m_check_fast_size_range(enum m_asserts type,
+					    unsigned long flags,
+					    const char *func,
+					    const unsigned int line,
+					    size_t min, size_t max, size_t val)
+{
+	int cond = (min <= val && val <= max);
+
+	if (type == M_SIZE_NRANGE)
+		cond = !cond;
+	if (M_LIKELY(cond))
+		return;
+	m_check_failed(type, flags, func, line, min, max, val);
+}
+
+M_CHECK_INLINE void m_check_fast_dbl(enum m_asserts type,
+				     unsigned long flags, const char *func,
+				     const unsigned int line,
+				     double a, double b)
+{
+	int cond;
+
+	/* Negated forms keep the original behavior with NaN */
+	switch (type) {
+	case M_DBL_EQ:
+		cond = (a == b);
+		break;
+	case M_DBL_NEQ:
+		cond = !(a == b);
+		break;
+	case M_DBL_GT:
+		cond = (a > b);
+		break;
+	case M_DBL_GE:
+		cond = (a >= b);
+		break;
+	case M_DBL_LT:
+		cond = !(a >= b);
+		break;
+	case M_DBL_LE:
+		cond = !(a > b);
+		break;
+	default:
+		cond = 0;
+		break;
+	}
+	if (M_LIKELY(cond))
+		return;
+	m_check_failed(type, flags, func, line, a, b);
+}
+
+M_CHECK_INLINE void m_check_fast_dbl_range(enum m_asserts type,
+					   unsigned long flags,
+					   const char *func,
+					   const unsigned int line,
+					   double min, double max, double val)
+{
+	int cond = (min <= val && val <= max);
+
+	if (type == M_DBL_NRANGE)
+		cond = !cond;
+	if (M_LIKELY(cond))
+		return;
+	m_check_failed(type, flags, func, line, min, max, val);
+}
+
+M_CHECK_INLINE void m_check_fast_ptr(enum m_asserts type,
+				     unsigned long flags, const char *func,
+				     const unsigned int line, void *ptr)
+{
+	int cond = (type == M_PTR_NULL) ? (ptr == NULL) : (ptr != NULL);
+
+	if (M_LIKELY(cond))
+		return;
+	m_check_failed(type, flags, func, line, ptr);
+}
+
+M_CHECK_INLINE int m_cond_fast_cmp(enum m_asserts type, int cmp)
+{
+	switch (type) {
+	case M_MEM_EQ:
+	case M_STR_EQ:
+		return cmp == 0;
+	case M_MEM_NEQ:
+	case M_STR_NEQ:
+		return cmp != 0;
+	case M_MEM_GT:
+	case M_STR_GT:
+		return cmp > 0;
+	case M_MEM_GE:
+	case M_STR_GE:
+		return cmp >= 0;
+	case M_MEM_LT:
+	case M_STR_LT:
+		return cmp < 0;
+	case M_MEM_LE:
+	case M_STR_LE:
+		return cmp <= 0;
+	default:
+		return 0;
+	}
+}
+
+M_CHECK_INLINE void m_check_fast_mem(enum m_asserts type,
+				     unsigned long flags, const char *func,
+				     const unsigned int line,
+				     void *a, void *b, size_t n)
+{
+	if (M_LIKELY(m_cond_fast_cmp(type, memcmp(a, b, n))))
+		return;
+	m_check_failed(type, flags, func, line, a, b, n);
+}
+
+M_CHECK_INLINE void m_check_fast_mem_range(enum m_asserts type,
+					   unsigned long flags,
+					   const char *func,
+					   const unsigned int line,
+					   void *min, void *max, void *val,
+					   size_t n)
+{
+	int cond = (memcmp(min, val, n) <= 0 && memcmp(val, max, n) <= 0);
+
+	if (type == M_MEM_NRANGE)
+		cond = !cond;
+	if (M_LIKELY(cond))
+		return;
+	m_check_failed(type, flags, func, line, min, max, val, n);
+}
+
+M_CHECK_INLINE void m_check_fast_str(enum m_asserts type,
+				     unsigned long flags, const char *func,
+				     const unsigned int line,
+				     char *a, char *b, size_t n)
+{
+	if (M_LIKELY(m_cond_fast_cmp(type, strncmp(a, b, n))))
+		return;
+	m_check_failed(type, flags, func, line, a, b, n);
+}
+
+M_CHECK_INLINE void m_check_fast_str_range(enum m_asserts type,
+					   unsigned long flags,
+					   const char *func,
+					   const unsigned int line,
+					   char *min, char *max, char *val,
+					   size_t n)
+{
+	int cond = (strncmp(min, val, n) <= 0 && strncmp(val, max, n) <= 0);
+
+	if (type == M_STR_NRANGE)
+		cond = !cond;
+	if (M_LIKELY(cond))
+		return;
+	m_check_failed(type, flags, func, line, min, max, val, n);
+}
 
 
 /**
@@ -260,13 +984,15 @@ extern void m_check(enum m_asserts type, unsigned long flags,
 /** @} */
 
 #define m_assert_custom(_cond, _errno, _fmt, ...)		\
-        m_check(M_CUSTOM, M_FLAG_STOP_ON_ERROR,			\
-		(__func__), (__LINE__), !!(_cond), (_errno),	\
-		(_fmt), __VA_ARGS__)
+	(M_LIKELY(_cond) ? (void)0 :				\
+	 m_check(M_CUSTOM, M_FLAG_STOP_ON_ERROR,		\
+		 (__func__), (__LINE__), 0, (_errno),		\
+		 (_fmt), __VA_ARGS__))
 #define m_check_custom(_cond, _errno, _fmt, ...)		\
-        m_check(M_CUSTOM, M_FLAG_CONT_ON_ERROR,			\
-		(__func__), (__LINE__), !!(_cond), (_errno),	\
-		(_fmt), __VA_ARGS__)
+	(M_LIKELY(_cond) ? (void)0 :				\
+	 m_check(M_CUSTOM, M_FLAG_CONT_ON_ERROR,		\
+		 (__func__), (__LINE__), 0, (_errno),		\
+		 (_fmt), __VA_ARGS__))
 
 
 /**
@@ -280,30 +1006,30 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _cond condition to evaluate
  */
 #define m_assert_true(_cond)				\
-	m_check(M_TRUE, M_FLAG_STOP_ON_ERROR,		\
-		(__func__), (__LINE__), (_cond))
+	m_check_fast_bool(M_TRUE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), !!(_cond))
 /**
  * If the given condition is not false it raise an error and it stops
  * test execution
  * @param[in] _cond condition to evaluate
  */
 #define m_assert_false(_cond)				\
-	m_check(M_FALSE, M_FLAG_STOP_ON_ERROR,		\
-		(__func__), (__LINE__), (_cond))
+	m_check_fast_bool(M_FALSE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), !!(_cond))
 /**
  * If the given condition is not true it raise an error
  * @param[in] _cond condition to evaluate
  */
 #define m_check_true(_cond)				\
-	m_check(M_TRUE, M_FLAG_CONT_ON_ERROR,		\
-		(__func__), (__LINE__), (_cond))
+	m_check_fast_bool(M_TRUE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), !!(_cond))
 /**
  * If the given condition is not false it raise an error
  * @param[in] _cond condition to evaluate
  */
 #define m_check_false(_cond)				\
-	m_check(M_FALSE, M_FLAG_CONT_ON_ERROR,		\
-		(__func__), (__LINE__), (_cond))
+	m_check_fast_bool(M_FALSE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), !!(_cond))
 /** @} */
 
 
@@ -324,8 +1050,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_int_eq(_exp, _val)			\
-	m_check(M_INT_EQ, M_FLAG_STOP_ON_ERROR,		\
-		(__func__), (__LINE__), (long)(_exp), (long)(_val))
+	m_check_fast_int(M_INT_EQ, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(_val))
 /**
  * If the given values are equal it raise an error and it stops
  * test execution
@@ -338,8 +1064,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_int_neq(_exp, _val)			\
-	m_check(M_INT_NEQ, M_FLAG_STOP_ON_ERROR,	\
-		(__func__), (__LINE__), (long)(_exp), (long)(_val))
+	m_check_fast_int(M_INT_NEQ, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(_val))
 /**
  * If the expected value is not greater than the given one it raise an error
  * and it stops test execution
@@ -352,8 +1078,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_int_gt(_exp, _val)			\
-	m_check(M_INT_GT, M_FLAG_STOP_ON_ERROR,		\
-		(__func__), (__LINE__), (long)(_exp), (long)(_val))
+	m_check_fast_int(M_INT_GT, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(_val))
 /**
  * If the expected value is not greater or equal than the given one it raise
  * an error and it stops test execution
@@ -366,8 +1092,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_int_ge(_exp, _val)			\
-	m_check(M_INT_GE, M_FLAG_STOP_ON_ERROR,		\
-		(__func__), (__LINE__), (long)(_exp), (long)(_val))
+	m_check_fast_int(M_INT_GE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(_val))
 /**
  * If the expected value is not less than the given one it raise an error
  * and it stops test execution
@@ -380,8 +1106,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_int_lt(_exp, _val)			\
-	m_check(M_INT_LT, M_FLAG_STOP_ON_ERROR,		\
-		(__func__), (__LINE__), (long)(_exp), (long)(_val))
+	m_check_fast_int(M_INT_LT, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(_val))
 /**
  * If the expected value is not less or equal than the given one it raise
  * an error and it stops test execution
@@ -394,8 +1120,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_int_le(_exp, _val)			\
-	m_check(M_INT_LE, M_FLAG_STOP_ON_ERROR,		\
-		(__func__), (__LINE__), (long)(_exp), (long)(_val))
+	m_check_fast_int(M_INT_LE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(_val))
 /**
  * If the given value is not within the range it raise an error
  * and it stops test execution
@@ -409,8 +1135,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_int_range(_min, _max, _val)			\
-	m_check(M_INT_RANGE, M_FLAG_STOP_ON_ERROR,		\
-		(__func__), (__LINE__), (long)(_min), (long)(_max), (long)(_val))
+	m_check_fast_int_range(M_INT_RANGE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_min), (int)(_max), (int)(_val))
 /**
  * If the given value is within the range it raise an error
  * and it stops test execution
@@ -424,8 +1150,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_int_nrange(_min, _max, _val)			\
-	m_check(M_INT_NRANGE, M_FLAG_STOP_ON_ERROR,		\
-		(__func__), (__LINE__), (long)(_min), (long)(_max), (long)(_val))
+	m_check_fast_int_range(M_INT_NRANGE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_min), (int)(_max), (int)(_val))
 
 /**
  * If the given values are not equal it raise an error
@@ -438,8 +1164,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_int_eq(_exp, _val)			\
-	m_check(M_INT_EQ, M_FLAG_CONT_ON_ERROR,		\
-		(__func__), (__LINE__), (long)(_exp), (long)(_val))
+	m_check_fast_int(M_INT_EQ, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(_val))
 /**
  * If the given values are equal it raise an error
  *
@@ -451,8 +1177,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_int_neq(_exp, _val)			\
-	m_check(M_INT_NEQ, M_FLAG_CONT_ON_ERROR,	\
-		(__func__), (__LINE__), (long)(_exp), (long)(_val))
+	m_check_fast_int(M_INT_NEQ, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(_val))
 /**
  * If the expected value is not greater than the given one it raise an error
  *
@@ -464,8 +1190,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_int_gt(_exp, _val)			\
-	m_check(M_INT_GT, M_FLAG_CONT_ON_ERROR,		\
-		(__func__), (__LINE__), (long)(_exp), (long)(_val))
+	m_check_fast_int(M_INT_GT, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(_val))
 /**
  * If the expected value is not greater or equal than the given one it raise
  * an error
@@ -478,8 +1204,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_int_ge(_exp, _val)			\
-	m_check(M_INT_GE, M_FLAG_CONT_ON_ERROR,		\
-		(__func__), (__LINE__), (long)(_exp), (long)(_val))
+	m_check_fast_int(M_INT_GE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(_val))
 /**
  * If the expected value is not less than the given one it raise an error
  *
@@ -491,8 +1217,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_int_lt(_exp, _val)			\
-	m_check(M_INT_LT, M_FLAG_CONT_ON_ERROR,		\
-		(__func__), (__LINE__), (long)(_exp), (long)(_val))
+	m_check_fast_int(M_INT_LT, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(_val))
 /**
  * If the expected value is not less or equal than the given one it raise
  * an error
@@ -505,8 +1231,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_int_le(_exp, _val)			\
-	m_check(M_INT_LE, M_FLAG_CONT_ON_ERROR,		\
-		(__func__), (__LINE__), (long)(_exp), (long)(_val))
+	m_check_fast_int(M_INT_LE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(_val))
 /**
  * If the given value is not within the range it raise an error
  *
@@ -519,8 +1245,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_int_range(_min, _max, _val)			\
-	m_check(M_INT_RANGE, M_FLAG_CONT_ON_ERROR,		\
-		(__func__), (__LINE__), (long)(_min), (long)(_max), (long)(_val))
+	m_check_fast_int_range(M_INT_RANGE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_min), (int)(_max), (int)(_val))
 /**
  * If the given value is within the range it raise an error
  *
@@ -533,8 +1259,446 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_int_nrange(_min, _max, _val)			\
-	m_check(M_INT_NRANGE, M_FLAG_CONT_ON_ERROR,		\
-		(__func__), (__LINE__), (long)(_min), (long)(_max), (long)(_val))
+	m_check_fast_int_range(M_INT_NRANGE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_min), (int)(_max), (int)(_val))
+/** @} */
+
+
+/**
+ * @addtogroup m_assert_i64 64-bit Signed Integer Assertions and Checks
+ * They are the integer assertions and checks for int64_t values: operands
+ * are not truncated to long (nor sign-converted), so they fit offsets,
+ * sizes and counters of any width.
+ * @{
+ */
+/**
+ * Like m_assert_int_eq(), for int64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_i64_eq(_exp, _val)			\
+	m_check_fast_i64(M_I64_EQ, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_exp), (int64_t)(_val))
+/**
+ * Like m_assert_int_neq(), for int64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_i64_neq(_exp, _val)			\
+	m_check_fast_i64(M_I64_NEQ, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_exp), (int64_t)(_val))
+/**
+ * Like m_assert_int_gt(), for int64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_i64_gt(_exp, _val)			\
+	m_check_fast_i64(M_I64_GT, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_exp), (int64_t)(_val))
+/**
+ * Like m_assert_int_ge(), for int64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_i64_ge(_exp, _val)			\
+	m_check_fast_i64(M_I64_GE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_exp), (int64_t)(_val))
+/**
+ * Like m_assert_int_lt(), for int64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_i64_lt(_exp, _val)			\
+	m_check_fast_i64(M_I64_LT, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_exp), (int64_t)(_val))
+/**
+ * Like m_assert_int_le(), for int64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_i64_le(_exp, _val)			\
+	m_check_fast_i64(M_I64_LE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_exp), (int64_t)(_val))
+/**
+ * Like m_assert_int_range(), for int64_t values
+ * @param[in] _min minimum expected value
+ * @param[in] _max maximum expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_i64_range(_min, _max, _val)			\
+	m_check_fast_i64_range(M_I64_RANGE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_min), (int64_t)(_max),	\
+		(int64_t)(_val))
+/**
+ * Like m_assert_int_nrange(), for int64_t values
+ * @param[in] _min minimum expected value
+ * @param[in] _max maximum expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_i64_nrange(_min, _max, _val)			\
+	m_check_fast_i64_range(M_I64_NRANGE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_min), (int64_t)(_max),	\
+		(int64_t)(_val))
+/**
+ * Like m_check_int_eq(), for int64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_i64_eq(_exp, _val)			\
+	m_check_fast_i64(M_I64_EQ, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_exp), (int64_t)(_val))
+/**
+ * Like m_check_int_neq(), for int64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_i64_neq(_exp, _val)			\
+	m_check_fast_i64(M_I64_NEQ, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_exp), (int64_t)(_val))
+/**
+ * Like m_check_int_gt(), for int64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_i64_gt(_exp, _val)			\
+	m_check_fast_i64(M_I64_GT, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_exp), (int64_t)(_val))
+/**
+ * Like m_check_int_ge(), for int64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_i64_ge(_exp, _val)			\
+	m_check_fast_i64(M_I64_GE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_exp), (int64_t)(_val))
+/**
+ * Like m_check_int_lt(), for int64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_i64_lt(_exp, _val)			\
+	m_check_fast_i64(M_I64_LT, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_exp), (int64_t)(_val))
+/**
+ * Like m_check_int_le(), for int64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_i64_le(_exp, _val)			\
+	m_check_fast_i64(M_I64_LE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_exp), (int64_t)(_val))
+/**
+ * Like m_check_int_range(), for int64_t values
+ * @param[in] _min minimum expected value
+ * @param[in] _max maximum expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_i64_range(_min, _max, _val)			\
+	m_check_fast_i64_range(M_I64_RANGE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_min), (int64_t)(_max),	\
+		(int64_t)(_val))
+/**
+ * Like m_check_int_nrange(), for int64_t values
+ * @param[in] _min minimum expected value
+ * @param[in] _max maximum expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_i64_nrange(_min, _max, _val)			\
+	m_check_fast_i64_range(M_I64_NRANGE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int64_t)(_min), (int64_t)(_max),	\
+		(int64_t)(_val))
+/** @} */
+
+
+/**
+ * @addtogroup m_assert_u64 64-bit Unsigned Integer Assertions and Checks
+ * They are the integer assertions and checks for uint64_t values: operands
+ * are not truncated to long (nor sign-converted), so they fit offsets,
+ * sizes and counters of any width.
+ * @{
+ */
+/**
+ * Like m_assert_int_eq(), for uint64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_u64_eq(_exp, _val)			\
+	m_check_fast_u64(M_U64_EQ, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_exp), (uint64_t)(_val))
+/**
+ * Like m_assert_int_neq(), for uint64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_u64_neq(_exp, _val)			\
+	m_check_fast_u64(M_U64_NEQ, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_exp), (uint64_t)(_val))
+/**
+ * Like m_assert_int_gt(), for uint64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_u64_gt(_exp, _val)			\
+	m_check_fast_u64(M_U64_GT, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_exp), (uint64_t)(_val))
+/**
+ * Like m_assert_int_ge(), for uint64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_u64_ge(_exp, _val)			\
+	m_check_fast_u64(M_U64_GE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_exp), (uint64_t)(_val))
+/**
+ * Like m_assert_int_lt(), for uint64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_u64_lt(_exp, _val)			\
+	m_check_fast_u64(M_U64_LT, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_exp), (uint64_t)(_val))
+/**
+ * Like m_assert_int_le(), for uint64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_u64_le(_exp, _val)			\
+	m_check_fast_u64(M_U64_LE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_exp), (uint64_t)(_val))
+/**
+ * Like m_assert_int_range(), for uint64_t values
+ * @param[in] _min minimum expected value
+ * @param[in] _max maximum expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_u64_range(_min, _max, _val)			\
+	m_check_fast_u64_range(M_U64_RANGE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_min), (uint64_t)(_max),	\
+		(uint64_t)(_val))
+/**
+ * Like m_assert_int_nrange(), for uint64_t values
+ * @param[in] _min minimum expected value
+ * @param[in] _max maximum expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_u64_nrange(_min, _max, _val)			\
+	m_check_fast_u64_range(M_U64_NRANGE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_min), (uint64_t)(_max),	\
+		(uint64_t)(_val))
+/**
+ * Like m_check_int_eq(), for uint64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_u64_eq(_exp, _val)			\
+	m_check_fast_u64(M_U64_EQ, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_exp), (uint64_t)(_val))
+/**
+ * Like m_check_int_neq(), for uint64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_u64_neq(_exp, _val)			\
+	m_check_fast_u64(M_U64_NEQ, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_exp), (uint64_t)(_val))
+/**
+ * Like m_check_int_gt(), for uint64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_u64_gt(_exp, _val)			\
+	m_check_fast_u64(M_U64_GT, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_exp), (uint64_t)(_val))
+/**
+ * Like m_check_int_ge(), for uint64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_u64_ge(_exp, _val)			\
+	m_check_fast_u64(M_U64_GE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_exp), (uint64_t)(_val))
+/**
+ * Like m_check_int_lt(), for uint64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_u64_lt(_exp, _val)			\
+	m_check_fast_u64(M_U64_LT, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_exp), (uint64_t)(_val))
+/**
+ * Like m_check_int_le(), for uint64_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_u64_le(_exp, _val)			\
+	m_check_fast_u64(M_U64_LE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_exp), (uint64_t)(_val))
+/**
+ * Like m_check_int_range(), for uint64_t values
+ * @param[in] _min minimum expected value
+ * @param[in] _max maximum expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_u64_range(_min, _max, _val)			\
+	m_check_fast_u64_range(M_U64_RANGE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_min), (uint64_t)(_max),	\
+		(uint64_t)(_val))
+/**
+ * Like m_check_int_nrange(), for uint64_t values
+ * @param[in] _min minimum expected value
+ * @param[in] _max maximum expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_u64_nrange(_min, _max, _val)			\
+	m_check_fast_u64_range(M_U64_NRANGE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (uint64_t)(_min), (uint64_t)(_max),	\
+		(uint64_t)(_val))
+/** @} */
+
+
+/**
+ * @addtogroup m_assert_size Size Assertions and Checks
+ * They are the integer assertions and checks for size_t values: operands
+ * are not truncated to long (nor sign-converted), so they fit offsets,
+ * sizes and counters of any width.
+ * @{
+ */
+/**
+ * Like m_assert_int_eq(), for size_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_size_eq(_exp, _val)			\
+	m_check_fast_size(M_SIZE_EQ, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_exp), (size_t)(_val))
+/**
+ * Like m_assert_int_neq(), for size_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_size_neq(_exp, _val)			\
+	m_check_fast_size(M_SIZE_NEQ, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_exp), (size_t)(_val))
+/**
+ * Like m_assert_int_gt(), for size_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_size_gt(_exp, _val)			\
+	m_check_fast_size(M_SIZE_GT, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_exp), (size_t)(_val))
+/**
+ * Like m_assert_int_ge(), for size_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_size_ge(_exp, _val)			\
+	m_check_fast_size(M_SIZE_GE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_exp), (size_t)(_val))
+/**
+ * Like m_assert_int_lt(), for size_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_size_lt(_exp, _val)			\
+	m_check_fast_size(M_SIZE_LT, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_exp), (size_t)(_val))
+/**
+ * Like m_assert_int_le(), for size_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_size_le(_exp, _val)			\
+	m_check_fast_size(M_SIZE_LE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_exp), (size_t)(_val))
+/**
+ * Like m_assert_int_range(), for size_t values
+ * @param[in] _min minimum expected value
+ * @param[in] _max maximum expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_size_range(_min, _max, _val)			\
+	m_check_fast_size_range(M_SIZE_RANGE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_min), (size_t)(_max),	\
+		(size_t)(_val))
+/**
+ * Like m_assert_int_nrange(), for size_t values
+ * @param[in] _min minimum expected value
+ * @param[in] _max maximum expected value
+ * @param[in] _val value to compare with
+ */
+#define m_assert_size_nrange(_min, _max, _val)			\
+	m_check_fast_size_range(M_SIZE_NRANGE, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_min), (size_t)(_max),	\
+		(size_t)(_val))
+/**
+ * Like m_check_int_eq(), for size_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_size_eq(_exp, _val)			\
+	m_check_fast_size(M_SIZE_EQ, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_exp), (size_t)(_val))
+/**
+ * Like m_check_int_neq(), for size_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_size_neq(_exp, _val)			\
+	m_check_fast_size(M_SIZE_NEQ, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_exp), (size_t)(_val))
+/**
+ * Like m_check_int_gt(), for size_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_size_gt(_exp, _val)			\
+	m_check_fast_size(M_SIZE_GT, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_exp), (size_t)(_val))
+/**
+ * Like m_check_int_ge(), for size_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_size_ge(_exp, _val)			\
+	m_check_fast_size(M_SIZE_GE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_exp), (size_t)(_val))
+/**
+ * Like m_check_int_lt(), for size_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_size_lt(_exp, _val)			\
+	m_check_fast_size(M_SIZE_LT, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_exp), (size_t)(_val))
+/**
+ * Like m_check_int_le(), for size_t values
+ * @param[in] _exp expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_size_le(_exp, _val)			\
+	m_check_fast_size(M_SIZE_LE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_exp), (size_t)(_val))
+/**
+ * Like m_check_int_range(), for size_t values
+ * @param[in] _min minimum expected value
+ * @param[in] _max maximum expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_size_range(_min, _max, _val)			\
+	m_check_fast_size_range(M_SIZE_RANGE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_min), (size_t)(_max),	\
+		(size_t)(_val))
+/**
+ * Like m_check_int_nrange(), for size_t values
+ * @param[in] _min minimum expected value
+ * @param[in] _max maximum expected value
+ * @param[in] _val value to compare with
+ */
+#define m_check_size_nrange(_min, _max, _val)			\
+	m_check_fast_size_range(M_SIZE_NRANGE, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (size_t)(_min), (size_t)(_max),	\
+		(size_t)(_val))
 /** @} */
 
 
@@ -554,7 +1718,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_dbl_eq(_exp, _val)		\
-	m_check(M_DBL_EQ, M_FLAG_STOP_ON_ERROR,	\
+	m_check_fast_dbl(M_DBL_EQ, M_FLAG_STOP_ON_ERROR,	\
 		(__func__), (__LINE__),		\
 		(double)(_exp), (double)(_val))
 /**
@@ -569,7 +1733,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_dbl_neq(_exp, _val)			\
-	m_check(M_DBL_NEQ, M_FLAG_STOP_ON_ERROR,	\
+	m_check_fast_dbl(M_DBL_NEQ, M_FLAG_STOP_ON_ERROR,	\
 		(__func__), (__LINE__),			\
 		(double)(_exp), (double)(_val))
 /**
@@ -584,7 +1748,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_dbl_gt(_exp, _val)		\
-	m_check(M_DBL_GT, M_FLAG_STOP_ON_ERROR,	\
+	m_check_fast_dbl(M_DBL_GT, M_FLAG_STOP_ON_ERROR,	\
 		(__func__), (__LINE__),		\
 		(double)(_exp), (double)(_val))
 /**
@@ -599,7 +1763,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_dbl_ge(_exp, _val)		\
-	m_check(M_DBL_GE, M_FLAG_STOP_ON_ERROR,	\
+	m_check_fast_dbl(M_DBL_GE, M_FLAG_STOP_ON_ERROR,	\
 		(__func__), (__LINE__),		\
 		(double)(_exp), (double)(_val))
 /**
@@ -614,7 +1778,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_dbl_lt(_exp, _val)		\
-	m_check(M_DBL_LT, M_FLAG_STOP_ON_ERROR,	\
+	m_check_fast_dbl(M_DBL_LT, M_FLAG_STOP_ON_ERROR,	\
 		(__func__), (__LINE__),		\
 		(double)(_exp), (double)(_val))
 /**
@@ -629,7 +1793,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_dbl_le(_exp, _val)		\
-	m_check(M_DBL_LE, M_FLAG_STOP_ON_ERROR,	\
+	m_check_fast_dbl(M_DBL_LE, M_FLAG_STOP_ON_ERROR,	\
 		(__func__), (__LINE__),		\
 		(double)(_exp), (double)(_val))
 /**
@@ -645,7 +1809,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_dbl_range(_min, _max, _val)			\
-	m_check(M_DBL_RANGE, M_FLAG_STOP_ON_ERROR,		\
+	m_check_fast_dbl_range(M_DBL_RANGE, M_FLAG_STOP_ON_ERROR,	\
 		(__func__), (__LINE__),				\
 		(double)(_min), (double)(_max), (double)(_val))
 /**
@@ -661,7 +1825,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_assert_dbl_nrange(_min, _max, _val)			\
-	m_check(M_DBL_NRANGE, M_FLAG_STOP_ON_ERROR,		\
+	m_check_fast_dbl_range(M_DBL_NRANGE, M_FLAG_STOP_ON_ERROR,	\
 		(__func__), (__LINE__),				\
 		(double)(_min), (double)(_max), (double)(_val))
 /**
@@ -675,7 +1839,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_dbl_eq(_exp, _val)		\
-	m_check(M_DBL_EQ, M_FLAG_CONT_ON_ERROR,	\
+	m_check_fast_dbl(M_DBL_EQ, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),		\
 		(double)(_exp), (double)(_val))
 /**
@@ -689,7 +1853,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_dbl_neq(_exp, _val)			\
-	m_check(M_DBL_NEQ, M_FLAG_CONT_ON_ERROR,	\
+	m_check_fast_dbl(M_DBL_NEQ, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),			\
 		(double)(_exp), (double)(_val))
 /**
@@ -703,7 +1867,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_dbl_gt(_exp, _val)		\
-	m_check(M_DBL_GT, M_FLAG_CONT_ON_ERROR,	\
+	m_check_fast_dbl(M_DBL_GT, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),		\
 		(double)(_exp), (double)(_val))
 /**
@@ -718,7 +1882,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_dbl_ge(_exp, _val)		\
-	m_check(M_DBL_GE, M_FLAG_CONT_ON_ERROR,	\
+	m_check_fast_dbl(M_DBL_GE, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),		\
 		(double)(_exp), (double)(_val))
 /**
@@ -732,7 +1896,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_dbl_lt(_exp, _val)		\
-	m_check(M_DBL_LT, M_FLAG_CONT_ON_ERROR,	\
+	m_check_fast_dbl(M_DBL_LT, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),		\
 		(double)(_exp), (double)(_val))
 /**
@@ -747,7 +1911,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_dbl_le(_exp, _val)		\
-	m_check(M_DBL_LE, M_FLAG_CONT_ON_ERROR,	\
+	m_check_fast_dbl(M_DBL_LE, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),		\
 		(double)(_exp), (double)(_val))
 /**
@@ -762,7 +1926,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_dbl_range(_min, _max, _val)			\
-	m_check(M_DBL_RANGE, M_FLAG_CONT_ON_ERROR,		\
+	m_check_fast_dbl_range(M_DBL_RANGE, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),				\
 		(double)(_min), (double)(_max), (double)(_val))
 /**
@@ -777,11 +1941,125 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _val value to compare with
  */
 #define m_check_dbl_nrange(_min, _max, _val)			\
-	m_check(M_DBL_NRANGE, M_FLAG_CONT_ON_ERROR,		\
+	m_check_fast_dbl_range(M_DBL_NRANGE, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),				\
 		(double)(_min), (double)(_max), (double)(_val))
 /** @} */
 
+/**
+ * @addtogroup m_assert_array Array Assertions and Checks
+ * They check whole arrays with a single call. The arrays are scanned with
+ * the widest vector instructions available on the running CPU; on failure
+ * they report the first failing element, how many elements fail and the
+ * largest error.
+ * @{
+ */
+
+/**
+ * If the given arrays are not equal it raise an error and it stops
+ * test execution
+ *
+ * _exp[i] == _val[i] for each i  OK
+ *
+ * _exp[i] != _val[i] for any i  Error
+ *
+ * @param[in] _exp expected values (int)
+ * @param[in] _val values to compare with (int)
+ * @param[in] _n number of elements
+ */
+#define m_assert_int_array_eq(_exp, _val, _n)				\
+	m_check_array_int_eq(M_FLAG_STOP_ON_ERROR, (__func__), (__LINE__),	\
+			     (_exp), (_val), (size_t)(_n))
+/**
+ * If any value is not within the range it raise an error and it stops
+ * test execution
+ *
+ * _min <= _val[i] <= _max for each i  OK
+ *
+ * _min > _val[i] || _max < _val[i] for any i  Error
+ *
+ * @param[in] _min minimum expected value
+ * @param[in] _max maximum expected value
+ * @param[in] _val values to compare with (int)
+ * @param[in] _n number of elements
+ */
+#define m_assert_int_array_all_in_range(_min, _max, _val, _n)		\
+	m_check_array_int_range(M_FLAG_STOP_ON_ERROR, (__func__), (__LINE__), \
+				(int)(_min), (int)(_max), (_val), (size_t)(_n))
+/**
+ * If the values are not in non-decreasing order it raise an error and it
+ * stops test execution
+ *
+ * _val[i] <= _val[i + 1] for each i  OK
+ *
+ * _val[i] > _val[i + 1] for any i  Error
+ *
+ * @param[in] _val values to verify (int)
+ * @param[in] _n number of elements
+ */
+#define m_assert_int_array_sorted(_val, _n)				\
+	m_check_array_int_sorted(M_FLAG_STOP_ON_ERROR, (__func__), (__LINE__), \
+				 (_val), (size_t)(_n))
+/**
+ * If the given arrays are not close enough it raise an error and it stops
+ * test execution. NaN values are never close to anything
+ *
+ * |_exp[i] - _val[i]| <= max(_abs, _rel * |_exp[i]|) for each i  OK
+ *
+ * |_exp[i] - _val[i]| > max(_abs, _rel * |_exp[i]|) for any i  Error
+ *
+ * @param[in] _exp expected values (double)
+ * @param[in] _val values to compare with (double)
+ * @param[in] _n number of elements
+ * @param[in] _abs absolute tolerance
+ * @param[in] _rel tolerance relative to the expected value
+ */
+#define m_assert_dbl_array_near(_exp, _val, _n, _abs, _rel)		\
+	m_check_array_dbl_near(M_FLAG_STOP_ON_ERROR, (__func__), (__LINE__), \
+			       (_exp), (_val), (size_t)(_n),		\
+			       (double)(_abs), (double)(_rel))
+
+/**
+ * If the given arrays are not equal it raise an error
+ * @param[in] _exp expected values (int)
+ * @param[in] _val values to compare with (int)
+ * @param[in] _n number of elements
+ */
+#define m_check_int_array_eq(_exp, _val, _n)				\
+	m_check_array_int_eq(M_FLAG_CONT_ON_ERROR, (__func__), (__LINE__),	\
+			     (_exp), (_val), (size_t)(_n))
+/**
+ * If any value is not within the range it raise an error
+ * @param[in] _min minimum expected value
+ * @param[in] _max maximum expected value
+ * @param[in] _val values to compare with (int)
+ * @param[in] _n number of elements
+ */
+#define m_check_int_array_all_in_range(_min, _max, _val, _n)		\
+	m_check_array_int_range(M_FLAG_CONT_ON_ERROR, (__func__), (__LINE__), \
+				(int)(_min), (int)(_max), (_val), (size_t)(_n))
+/**
+ * If the values are not in non-decreasing order it raise an error
+ * @param[in] _val values to verify (int)
+ * @param[in] _n number of elements
+ */
+#define m_check_int_array_sorted(_val, _n)				\
+	m_check_array_int_sorted(M_FLAG_CONT_ON_ERROR, (__func__), (__LINE__), \
+				 (_val), (size_t)(_n))
+/**
+ * If the given arrays are not close enough it raise an error
+ * @param[in] _exp expected values (double)
+ * @param[in] _val values to compare with (double)
+ * @param[in] _n number of elements
+ * @param[in] _abs absolute tolerance
+ * @param[in] _rel tolerance relative to the expected value
+ */
+#define m_check_dbl_array_near(_exp, _val, _n, _abs, _rel)		\
+	m_check_array_dbl_near(M_FLAG_CONT_ON_ERROR, (__func__), (__LINE__), \
+			       (_exp), (_val), (size_t)(_n),		\
+			       (double)(_abs), (double)(_rel))
+/** @} */
+
 /**
  * @addtogroup m_assert_mem Memory Assertions and Checks
  * @{
@@ -798,7 +2076,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _ptr pointer to evaluate
  */
 #define m_assert_mem_not_null(_ptr)			\
-	m_check(M_PTR_NOT_NULL, M_FLAG_STOP_ON_ERROR,	\
+	m_check_fast_ptr(M_PTR_NOT_NULL, M_FLAG_STOP_ON_ERROR,	\
 		(__func__), (__LINE__),			\
 		(void *)(_ptr))
 /**
@@ -812,7 +2090,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _ptr pointer to evaluate
  */
 #define m_assert_mem_null(_ptr)				\
-	m_check(M_PTR_NULL, M_FLAG_STOP_ON_ERROR,	\
+	m_check_fast_ptr(M_PTR_NULL, M_FLAG_STOP_ON_ERROR,	\
 		(__func__), (__LINE__),			\
 		(void *)(_ptr))
 /**
@@ -828,7 +2106,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_assert_mem_eq(_exp, _val, _size)				\
-	m_check(M_MEM_EQ, M_FLAG_STOP_ON_ERROR,				\
+	m_check_fast_mem(M_MEM_EQ, M_FLAG_STOP_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(void *)(_exp), (void *)(_val), (size_t)(_size))
 /**
@@ -844,7 +2122,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_assert_mem_neq(_exp, _val, _size)				\
-	m_check(M_MEM_NEQ, M_FLAG_STOP_ON_ERROR,			\
+	m_check_fast_mem(M_MEM_NEQ, M_FLAG_STOP_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(void *)(_exp), (void *)(_val), (size_t)(_size))
 /**
@@ -860,7 +2138,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_assert_mem_gt(_exp, _val, _size)				\
-	m_check(M_MEM_GT, M_FLAG_STOP_ON_ERROR,				\
+	m_check_fast_mem(M_MEM_GT, M_FLAG_STOP_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(void *)(_exp), (void *)(_val), (size_t)(_size))
 /**
@@ -876,7 +2154,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_assert_mem_ge(_exp, _val, _size)				\
-	m_check(M_MEM_GE, M_FLAG_STOP_ON_ERROR,				\
+	m_check_fast_mem(M_MEM_GE, M_FLAG_STOP_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(void *)(_exp), (void *)(_val), (size_t)(_size))
 /**
@@ -892,7 +2170,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_assert_mem_lt(_exp, _val, _size)				\
-	m_check(M_MEM_LT, M_FLAG_STOP_ON_ERROR,				\
+	m_check_fast_mem(M_MEM_LT, M_FLAG_STOP_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(void *)(_exp), (void *)(_val), (size_t)(_size))
 /**
@@ -908,7 +2186,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_assert_mem_le(_exp, _val, _size)				\
-	m_check(M_MEM_LE, M_FLAG_STOP_ON_ERROR,				\
+	m_check_fast_mem(M_MEM_LE, M_FLAG_STOP_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(void *)(_exp), (void *)(_val), (size_t)(_size))
 /**
@@ -925,7 +2203,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_assert_mem_range(_min, _max, _val, _size)			\
-	m_check(M_MEM_RANGE, M_FLAG_STOP_ON_ERROR,			\
+	m_check_fast_mem_range(M_MEM_RANGE, M_FLAG_STOP_ON_ERROR,	\
 		(__func__), (__LINE__),					\
 		(void *)(_min), (void *)(_max), (void *)(_val),		\
 		(size_t)(_size))
@@ -943,7 +2221,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_assert_mem_nrange(_min, _max, _val, _size)			\
-	m_check(M_MEM_NRANGE, M_FLAG_STOP_ON_ERROR,			\
+	m_check_fast_mem_range(M_MEM_NRANGE, M_FLAG_STOP_ON_ERROR,	\
 		(__func__), (__LINE__),					\
 		(void *)(_min), (void *)(_max), (void *)(_val),		\
 		(size_t)(_size))
@@ -957,7 +2235,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _ptr pointer to evaluate
  */
 #define m_check_mem_not_null(_ptr)			\
-	m_check(M_PTR_NOT_NULL, M_FLAG_CONT_ON_ERROR,	\
+	m_check_fast_ptr(M_PTR_NOT_NULL, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),			\
 		(void *)(_ptr))
 /**
@@ -970,7 +2248,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _ptr pointer to evaluate
  */
 #define m_check_mem_null(_ptr)				\
-	m_check(M_PTR_NULL, M_FLAG_CONT_ON_ERROR,	\
+	m_check_fast_ptr(M_PTR_NULL, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),			\
 		(void *)(_ptr))
 /**
@@ -985,7 +2263,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_check_mem_eq(_exp, _val, _size)				\
-	m_check(M_MEM_EQ, M_FLAG_CONT_ON_ERROR,				\
+	m_check_fast_mem(M_MEM_EQ, M_FLAG_CONT_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(void *)(_exp), (void *)(_val), (size_t)(_size))
 /**
@@ -1000,7 +2278,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_check_mem_neq(_exp, _val, _size)				\
-	m_check(M_MEM_NEQ, M_FLAG_CONT_ON_ERROR,			\
+	m_check_fast_mem(M_MEM_NEQ, M_FLAG_CONT_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(void *)(_exp), (void *)(_val), (size_t)(_size))
 /**
@@ -1016,7 +2294,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_check_mem_gt(_exp, _val, _size)				\
-	m_check(M_MEM_GT, M_FLAG_CONT_ON_ERROR,				\
+	m_check_fast_mem(M_MEM_GT, M_FLAG_CONT_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(void *)(_exp), (void *)(_val), (size_t)(_size))
 /**
@@ -1032,7 +2310,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_check_mem_ge(_exp, _val, _size)				\
-	m_check(M_MEM_GE, M_FLAG_CONT_ON_ERROR,				\
+	m_check_fast_mem(M_MEM_GE, M_FLAG_CONT_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(void *)(_exp), (void *)(_val), (size_t)(_size))
 /**
@@ -1048,7 +2326,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_check_mem_lt(_exp, _val, _size)				\
-	m_check(M_MEM_LT, M_FLAG_CONT_ON_ERROR,				\
+	m_check_fast_mem(M_MEM_LT, M_FLAG_CONT_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(void *)(_exp), (void *)(_val), (size_t)(_size))
 /**
@@ -1064,7 +2342,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_check_mem_le(_exp, _val, _size)				\
-	m_check(M_MEM_LE, M_FLAG_CONT_ON_ERROR,				\
+	m_check_fast_mem(M_MEM_LE, M_FLAG_CONT_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(void *)(_exp), (void *)(_val), (size_t)(_size))
 /**
@@ -1080,7 +2358,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_check_mem_range(_min, _max, _val, _size)			\
-	m_check(M_MEM_RANGE, M_FLAG_CONT_ON_ERROR,			\
+	m_check_fast_mem_range(M_MEM_RANGE, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),					\
 		(void *)(_min), (void *)(_max), (void *)(_val),		\
 		(size_t)(_size))
@@ -1097,7 +2375,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _size memory size to evaluate
  */
 #define m_check_mem_nrange(_min, _max, _val, _size)			\
-	m_check(M_MEM_NRANGE, M_FLAG_CONT_ON_ERROR,			\
+	m_check_fast_mem_range(M_MEM_NRANGE, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),					\
 		(void *)(_min), (void *)(_max), (void *)(_val),		\
 		(size_t)(_size))
@@ -1106,6 +2384,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
 
 /**
  * @addtogroup m_assert_str String Assertions and Checks
+ * Strings are compared like strncmp() does: up to the first NUL or up to
+ * _size characters, so buffers that are not NUL terminated are safe.
  * @{
  */
 /**
@@ -1140,10 +2420,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  *
  * @param[in] _exp expected strings
  * @param[in] _val stringsto compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_assert_str_eq(_exp, _val, _size)				\
-	m_check(M_STR_EQ, M_FLAG_STOP_ON_ERROR,				\
+	m_check_fast_str(M_STR_EQ, M_FLAG_STOP_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(char *)(_exp), (char *)(_val), (size_t)(_size))
 /**
@@ -1156,10 +2436,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  *
  * @param[in] _exp expected strings
  * @param[in] _val stringsto compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_assert_str_neq(_exp, _val, _size)				\
-	m_check(M_STR_NEQ, M_FLAG_STOP_ON_ERROR,			\
+	m_check_fast_str(M_STR_NEQ, M_FLAG_STOP_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(char *)(_exp), (char *)(_val), (size_t)(_size))
 /**
@@ -1172,10 +2452,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  *
  * @param[in] _exp expected strings
  * @param[in] _val stringsto compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_assert_str_gt(_exp, _val, _size)				\
-	m_check(M_STR_GT, M_FLAG_STOP_ON_ERROR,				\
+	m_check_fast_str(M_STR_GT, M_FLAG_STOP_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(char *)(_exp), (char *)(_val), (size_t)(_size))
 /**
@@ -1188,10 +2468,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  *
  * @param[in] _exp expected strings
  * @param[in] _val stringsto compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_assert_str_ge(_exp, _val, _size)				\
-	m_check(M_STR_GE, M_FLAG_STOP_ON_ERROR,				\
+	m_check_fast_str(M_STR_GE, M_FLAG_STOP_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(char *)(_exp), (char *)(_val), (size_t)(_size))
 /**
@@ -1204,10 +2484,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  *
  * @param[in] _exp expected strings
  * @param[in] _val stringsto compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_assert_str_lt(_exp, _val, _size)				\
-	m_check(M_STR_LT, M_FLAG_STOP_ON_ERROR,				\
+	m_check_fast_str(M_STR_LT, M_FLAG_STOP_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(char *)(_exp), (char *)(_val), (size_t)(_size))
 /**
@@ -1220,10 +2500,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  *
  * @param[in] _exp expected strings
  * @param[in] _val stringsto compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_assert_str_le(_exp, _val, _size)				\
-	m_check(M_STR_LE, M_FLAG_STOP_ON_ERROR,				\
+	m_check_fast_str(M_STR_LE, M_FLAG_STOP_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(char *)(_exp), (char *)(_val), (size_t)(_size))
 /**
@@ -1237,10 +2517,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _min expected minumum string
  * @param[in] _max expected maximum string
  * @param[in] _val string to compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_assert_str_range(_min, _max, _val, _size)			\
-	m_check(M_STR_RANGE, M_FLAG_STOP_ON_ERROR,			\
+	m_check_fast_str_range(M_STR_RANGE, M_FLAG_STOP_ON_ERROR,	\
 		(__func__), (__LINE__),					\
 		(char *)(_min), (char *)(_max), (char *)(_val),		\
 		(size_t)(_size))
@@ -1255,10 +2535,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _min expected minumum string
  * @param[in] _max expected maximum string
  * @param[in] _val string to compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_assert_str_nrange(_min, _max, _val, _size)			\
-	m_check(M_STR_NRANGE, M_FLAG_STOP_ON_ERROR,			\
+	m_check_fast_str_range(M_STR_NRANGE, M_FLAG_STOP_ON_ERROR,	\
 		(__func__), (__LINE__),					\
 		(char *)(_min), (char *)(_max), (char *)(_val),		\
 		(size_t)(_size))
@@ -1273,7 +2553,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _ptr pointer to evaluate
  */
 #define m_check_str_not_null(_ptr)			\
-	m_check(M_PTR_NOT_NULL, M_FLAG_CONT_ON_ERROR,	\
+	m_check_fast_ptr(M_PTR_NOT_NULL, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),			\
 		(char *)(_ptr))
 /**
@@ -1286,7 +2566,7 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _ptr pointer to evaluate
  */
 #define m_check_str_null(_ptr)				\
-	m_check(M_PTR_NULL, M_FLAG_CONT_ON_ERROR,	\
+	m_check_fast_ptr(M_PTR_NULL, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),			\
 		(char *)(_ptr))
 /**
@@ -1298,10 +2578,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  *
  * @param[in] _exp expected strings
  * @param[in] _val stringsto compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_check_str_eq(_exp, _val, _size)				\
-	m_check(M_STR_EQ, M_FLAG_CONT_ON_ERROR,				\
+	m_check_fast_str(M_STR_EQ, M_FLAG_CONT_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(char *)(_exp), (char *)(_val), (size_t)(_size))
 /**
@@ -1313,10 +2593,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  *
  * @param[in] _exp expected strings
  * @param[in] _val stringsto compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_check_str_neq(_exp, _val, _size)				\
-	m_check(M_STR_NEQ, M_FLAG_CONT_ON_ERROR,			\
+	m_check_fast_str(M_STR_NEQ, M_FLAG_CONT_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(char *)(_exp), (char *)(_val), (size_t)(_size))
 /**
@@ -1329,10 +2609,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  *
  * @param[in] _exp expected strings
  * @param[in] _val stringsto compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_check_str_gt(_exp, _val, _size)				\
-	m_check(M_STR_GT, M_FLAG_CONT_ON_ERROR,				\
+	m_check_fast_str(M_STR_GT, M_FLAG_CONT_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(char *)(_exp), (char *)(_val), (size_t)(_size))
 /**
@@ -1345,10 +2625,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  *
  * @param[in] _exp expected strings
  * @param[in] _val stringsto compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_check_str_ge(_exp, _val, _size)				\
-	m_check(M_STR_GE, M_FLAG_CONT_ON_ERROR,				\
+	m_check_fast_str(M_STR_GE, M_FLAG_CONT_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(char *)(_exp), (char *)(_val), (size_t)(_size))
 /**
@@ -1361,10 +2641,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  *
  * @param[in] _exp expected strings
  * @param[in] _val stringsto compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_check_str_lt(_exp, _val, _size)				\
-	m_check(M_STR_LT, M_FLAG_CONT_ON_ERROR,				\
+	m_check_fast_str(M_STR_LT, M_FLAG_CONT_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(char *)(_exp), (char *)(_val), (size_t)(_size))
 /**
@@ -1377,10 +2657,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  *
  * @param[in] _exp expected strings
  * @param[in] _val stringsto compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_check_str_le(_exp, _val, _size)				\
-	m_check(M_STR_LE, M_FLAG_CONT_ON_ERROR,				\
+	m_check_fast_str(M_STR_LE, M_FLAG_CONT_ON_ERROR,		\
 		(__func__), (__LINE__),					\
 		(char *)(_exp), (char *)(_val), (size_t)(_size))
 /**
@@ -1393,10 +2673,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _min expected minumum string
  * @param[in] _max expected maximum string
  * @param[in] _val string to compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_check_str_range(_min, _max, _val, _size)			\
-	m_check(M_STR_RANGE, M_FLAG_CONT_ON_ERROR,			\
+	m_check_fast_str_range(M_STR_RANGE, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),					\
 		(char *)(_min), (char *)(_max), (char *)(_val),		\
 		(size_t)(_size))
@@ -1410,10 +2690,10 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _min expected minumum string
  * @param[in] _max expected maximum string
  * @param[in] _val string to compare with
- * @param[in] _size maximum string length
+ * @param[in] _size maximum number of characters to compare
  */
 #define m_check_str_nrange(_min, _max, _val, _size)			\
-	m_check(M_STR_NRANGE, M_FLAG_CONT_ON_ERROR,			\
+	m_check_fast_str_range(M_STR_NRANGE, M_FLAG_CONT_ON_ERROR,	\
 		(__func__), (__LINE__),					\
 		(char *)(_min), (char *)(_max), (char *)(_val),		\
 		(size_t)(_size))
@@ -1436,8 +2716,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _exp expected error
  */
 #define m_assert_errno_eq(_exp)					\
-	m_check(M_ERR_EQ, M_FLAG_STOP_ON_ERROR,			\
-		(__func__), (__LINE__), (long)(_exp), (long)(errno))
+	m_check_fast_int(M_ERR_EQ, M_FLAG_STOP_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(errno))
 
 /**
  * If the given error code is equal to errno, it raises an error and it
@@ -1450,8 +2730,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _exp not expected error
  */
 #define m_assert_errno_neq(_exp)					\
-	m_check(M_INT_NEQ, M_FLAG_STOP_ON_ERROR,			\
-		(__func__), (__LINE__), (long)(_exp), (long)(errno))
+	m_check_fast_int(M_INT_NEQ, M_FLAG_STOP_ON_ERROR,		\
+		(__func__), (__LINE__), (int)(_exp), (int)(errno))
 
 /**
  * If the given error code is not equal to errno, it raises an error and it
@@ -1464,8 +2744,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _exp expected error
  */
 #define m_check_errno_eq(_exp)					\
-	m_check(M_ERR_EQ, M_FLAG_CONT_ON_ERROR,			\
-		(__func__), (__LINE__), (long)(_exp), (long)(errno))
+	m_check_fast_int(M_ERR_EQ, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(errno))
 
 /**
  * If the given error code is equal to errno, it raises an error and it
@@ -1478,8 +2758,8 @@ extern void m_check(enum m_asserts type, unsigned long flags,
  * @param[in] _exp not expected error
  */
 #define m_check_errno_neq(_exp)					\
-	m_check(M_ERR_NEQ, M_FLAG_CONT_ON_ERROR,			\
-		(__func__), (__LINE__), (long)(_exp), (long)(errno))
+	m_check_fast_int(M_ERR_NEQ, M_FLAG_CONT_ON_ERROR,	\
+		(__func__), (__LINE__), (int)(_exp), (int)(errno))
 /** @} */
 
 #endif
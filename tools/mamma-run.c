@@ -0,0 +1,394 @@
+/**
+ * Copyright 2015 Federico Vaga <www.federicovaga.com>
+ *
+ * mamma-run loads test shared objects and it runs all their suites in
+ * a single process, through m_main(). Shared objects export their suites
+ * with M_TEST_LIBRARY() (registered tests) and/or with a NULL terminated
+ * array `struct m_suite *m_suites[]`. They must be linked against
+ * libmamma.so, so that they share the runner's library.
+ *
+ * With --watch, mamma-run keeps running: when a shared object is rebuilt
+ * it is loaded again and only its suites run again; one that does not
+ * load leaves the previous version in place.
+ */
+#define _GNU_SOURCE /* dlinfo(), dladdr1() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <mamma.h>
+
+/**
+ * Time to wait for the build to settle before reloading (ms)
+ */
+#define M_RUN_SETTLE_MS 200
+
+/**
+ * A test shared object
+ */
+struct m_library {
+	const char *path; /**< shared object path */
+	void *handle; /**< dlopen() handle, NULL when not loaded */
+	struct m_suite **suites; /**< suites of the shared object */
+	unsigned int suite_count; /**< number of suites */
+	struct m_suite *registered; /**< suites of the registered tests */
+	int wd; /**< inotify watch on the shared object directory */
+	int changed; /**< it has been rebuilt since the last run */
+};
+
+static volatile sig_atomic_t m_run_stop;
+
+/**
+ * It tells if a command line argument is a test shared object
+ * @param[in] arg command line argument
+ * @return 1 when it is a shared object, 0 otherwise
+ */
+static int m_run_is_library(const char *arg)
+{
+	size_t len = strlen(arg);
+
+	return arg[0] != '-' &&
+	       ((len > 3 && !strcmp(arg + len - 3, ".so")) ||
+		strstr(arg, ".so."));
+}
+
+/**
+ * It unloads a test shared object
+ * @param[in] lib the shared object
+ */
+static void m_library_unload(struct m_library *lib)
+{
+	if (lib->handle)
+		dlclose(lib->handle);
+	lib->handle = NULL;
+	free(lib->suites);
+	free(lib->registered);
+	lib->suites = NULL;
+	lib->registered = NULL;
+	lib->suite_count = 0;
+}
+
+/**
+ * It loads a test shared object and it collects its suites
+ * @param[in] lib the shared object
+ * @return 0 on success, -1 on error
+ */
+static int m_library_load(struct m_library *lib)
+{
+	struct m_test *(*library_tests)(struct m_test **stop);
+	struct m_suite **suites;
+	struct m_test *start = NULL, *stop = NULL;
+	unsigned int i, n = 0, nreg = 0;
+
+	/* Without a slash dlopen() would search the library path */
+	if (!strchr(lib->path, '/')) {
+		char local[strlen(lib->path) + 3];
+
+		snprintf(local, sizeof(local), "./%s", lib->path);
+		lib->handle = dlopen(local, RTLD_NOW | RTLD_LOCAL);
+	} else {
+		lib->handle = dlopen(lib->path, RTLD_NOW | RTLD_LOCAL);
+	}
+	if (!lib->handle) {
+		fprintf(stdout, "Cannot load \"%s\": %s\n", lib->path,
+			dlerror());
+		return -1;
+	}
+
+	suites = dlsym(lib->handle, "m_suites");
+	while (suites && suites[n])
+		n++;
+	library_tests = (struct m_test *(*)(struct m_test **))
+		dlsym(lib->handle, "m_library_tests");
+	if (library_tests) {
+		start = library_tests(&stop);
+		nreg = m_registered_suites(start, stop, NULL);
+	}
+	if (!n && !nreg)
+		fprintf(stdout, "No tests in \"%s\"\n", lib->path);
+
+	lib->suites = calloc(n + nreg + 1, sizeof(*lib->suites));
+	lib->registered = calloc(nreg + 1, sizeof(*lib->registered));
+	if (!lib->suites || !lib->registered) {
+		m_library_unload(lib);
+		return -1;
+	}
+	for (i = 0; i < n; ++i)
+		lib->suites[lib->suite_count++] = suites[i];
+	m_registered_suites(start, stop, lib->registered);
+	for (i = 0; i < nreg; ++i)
+		lib->suites[lib->suite_count++] = &lib->registered[i];
+
+	return 0;
+}
+
+/**
+ * It tells if a rebuilt shared object loads, without giving up the loaded
+ * one: when the rebuilt one is broken, the suites keep running the loaded
+ * code. The check runs in a child process, because dlopen() would return
+ * the loaded object
+ * @param[in] lib the shared object
+ * @return 1 when it loads, 0 otherwise
+ */
+static int m_library_loads(struct m_library *lib)
+{
+	struct m_library tmp = { .path = lib->path };
+	int status;
+	pid_t pid;
+
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0)
+		return 1; /* let the real load tell */
+	if (!pid) {
+		if (lib->handle)
+			dlclose(lib->handle);
+		status = m_library_load(&tmp);
+		fflush(stdout);
+		_exit(status < 0);
+	}
+	while (waitpid(pid, &status, 0) < 0)
+		if (errno != EINTR)
+			return 1;
+
+	return WIFEXITED(status) && !WEXITSTATUS(status);
+}
+
+/**
+ * It tears down the kept set_up environments that point into a shared
+ * object about to be unloaded, with the tear_down() of the loaded code:
+ * they would be dangling for the reloaded suites. The other environments
+ * go to the reloaded suites; they must not reference the shared object
+ * in any other way, because that cannot be detected
+ * @param[in] lib the shared object
+ */
+static void m_library_release_own(struct m_library *lib)
+{
+	struct link_map *map, *owner;
+	unsigned int i;
+	Dl_info info;
+	void *kept;
+
+	if (!lib->handle || dlinfo(lib->handle, RTLD_DI_LINKMAP, &map))
+		return;
+	for (i = 0; i < lib->suite_count; ++i) {
+		kept = m_suite_kept(lib->suites[i]);
+		if (!kept || !dladdr1(kept, &info, (void **)&owner,
+				      RTLD_DL_LINKMAP) || owner != map)
+			continue;
+		fprintf(stdout, "Releasing the kept environment of \"%s\", it points into \"%s\"\n",
+			lib->suites[i]->name, lib->path);
+		m_suite_release(lib->suites[i]);
+	}
+}
+
+/**
+ * It runs the suites of the given shared objects with a single report
+ * @param[in] libs shared objects
+ * @param[in] n number of shared objects
+ * @param[in] only run only the shared objects marked as changed
+ * @param[in] argc number of m_main() arguments
+ * @param[in] argv m_main() arguments
+ * @return the m_main() exit status
+ */
+static int m_run(struct m_library *libs, unsigned int n, int only,
+		 int argc, char *argv[])
+{
+	unsigned int i, j, count = 0;
+	int ret;
+
+	for (i = 0; i < n; ++i)
+		count += libs[i].suite_count;
+
+	{
+		struct m_suite *suites[count ? count : 1];
+
+		for (i = 0, count = 0; i < n; ++i) {
+			if (only && !libs[i].changed)
+				continue;
+			for (j = 0; j < libs[i].suite_count; ++j)
+				suites[count++] = libs[i].suites[j];
+		}
+		ret = m_main(argc, argv, suites, count);
+	}
+
+	return ret;
+}
+
+static void m_run_sigint(int sig)
+{
+	m_run_stop = 1;
+}
+
+/**
+ * It reads the pending inotify events and it marks the shared objects
+ * that have been rebuilt
+ * @param[in] fd inotify file descriptor
+ * @param[in] libs shared objects
+ * @param[in] n number of shared objects
+ * @return 0 on success, -1 on error
+ */
+static int m_run_events(int fd, struct m_library *libs, unsigned int n)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	const char *name;
+	unsigned int i;
+	ssize_t len;
+	char *p;
+
+	len = read(fd, buf, sizeof(buf));
+	if (len < 0)
+		return errno == EINTR ? 0 : -1;
+
+	for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+		ev = (const struct inotify_event *)p;
+		if (!ev->len)
+			continue;
+		for (i = 0; i < n; ++i) {
+			name = strrchr(libs[i].path, '/');
+			name = name ? name + 1 : libs[i].path;
+			if (libs[i].wd == ev->wd && !strcmp(name, ev->name))
+				libs[i].changed = 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * It watches the shared objects and it runs again the suites of those
+ * that get rebuilt, until SIGINT. Shared objects are watched through
+ * their directory because builds often replace the file
+ * @param[in] libs shared objects
+ * @param[in] n number of shared objects
+ * @param[in] argc number of m_main() arguments
+ * @param[in] argv m_main() arguments
+ * @return 0 on success, -1 on error
+ */
+static int m_run_watch(struct m_library *libs, unsigned int n,
+		       int argc, char *argv[])
+{
+	struct sigaction sa;
+	struct pollfd pfd;
+	unsigned int i, changed;
+	int fd;
+
+	fd = inotify_init1(IN_CLOEXEC);
+	if (fd < 0) {
+		fprintf(stdout, "Cannot watch: %s\n", strerror(errno));
+		return -1;
+	}
+	for (i = 0; i < n; ++i) {
+		const char *slash = strrchr(libs[i].path, '/');
+		char dir[slash ? slash - libs[i].path + 2 : 2];
+
+		if (slash)
+			snprintf(dir, sizeof(dir), "%.*s",
+				 (int)(slash - libs[i].path + 1), libs[i].path);
+		else
+			strcpy(dir, ".");
+		libs[i].wd = inotify_add_watch(fd, dir,
+					       IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (libs[i].wd < 0)
+			fprintf(stdout, "Cannot watch \"%s\": %s\n", dir,
+				strerror(errno));
+	}
+
+	/* No SA_RESTART: Ctrl-C must interrupt read() */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = m_run_sigint;
+	sigaction(SIGINT, &sa, NULL);
+
+	fprintf(stdout, "Watching %u shared objects, Ctrl-C to stop\n", n);
+	fflush(stdout);
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while (!m_run_stop) {
+		if (m_run_events(fd, libs, n) < 0)
+			break;
+		/* Let the build finish writing them */
+		while (!m_run_stop && poll(&pfd, 1, M_RUN_SETTLE_MS) > 0)
+			if (m_run_events(fd, libs, n) < 0)
+				break;
+		if (m_run_stop)
+			break;
+
+		/* A broken build keeps the previous version loaded */
+		for (i = 0, changed = 0; i < n; ++i) {
+			if (!libs[i].changed)
+				continue;
+			libs[i].changed = 0;
+			fprintf(stdout, "Reloading \"%s\"\n", libs[i].path);
+			if (!m_library_loads(&libs[i])) {
+				fprintf(stdout, "Keeping the previous \"%s\"\n",
+					libs[i].path);
+				continue;
+			}
+			m_library_release_own(&libs[i]);
+			m_library_unload(&libs[i]);
+			if (m_library_load(&libs[i]) < 0)
+				continue;
+			libs[i].changed = 1;
+			changed++;
+		}
+		if (changed)
+			m_run(libs, n, 1, argc, argv);
+		fflush(stdout);
+		for (i = 0; i < n; ++i)
+			libs[i].changed = 0;
+	}
+
+	close(fd);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct m_library *libs;
+	unsigned int i, n = 0;
+	char **args;
+	int nargs = 0, watch = 0, ret;
+
+	libs = calloc(argc, sizeof(*libs));
+	args = calloc(argc + 1, sizeof(*args));
+	if (!libs || !args)
+		return EXIT_FAILURE;
+
+	/* Shared objects are ours, everything else goes to m_main() */
+	for (i = 0; i < argc; ++i) {
+		if (i && !strcmp(argv[i], "--watch"))
+			watch = 1;
+		else if (i && m_run_is_library(argv[i]))
+			libs[n++].path = argv[i];
+		else
+			args[nargs++] = argv[i];
+	}
+
+	for (i = 0; i < n; ++i)
+		if (m_library_load(&libs[i]) < 0)
+			return EXIT_FAILURE;
+
+	ret = m_run(libs, n, 0, nargs, args);
+	fflush(stdout);
+	if (watch && m_run_watch(libs, n, nargs, args) < 0)
+		ret = EXIT_FAILURE;
+
+	for (i = 0; i < n; ++i) {
+		unsigned int j;
+
+		for (j = 0; j < libs[i].suite_count; ++j)
+			m_suite_release(libs[i].suites[j]);
+		m_library_unload(&libs[i]);
+	}
+	free(libs);
+	free(args);
+	return ret;
+}
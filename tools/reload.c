@@ -0,0 +1,150 @@
+/**
+ * mamma-run --watch: a rebuilt shared object is loaded again and its
+ * suites run again. Kept set_up environments on the heap go to the
+ * reloaded suites, those that point into the old object are torn down
+ * by the old code before it is unloaded. Run it from tools/
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <mamma.h>
+
+/* Time to wait for mamma-run output (ms) */
+#define RELOAD_WAIT_MS 10000
+
+static char reload_out[16384];
+static size_t reload_len;
+
+/* It copies a shared object and it moves it in place, like a build */
+static int reload_install(const char *src, const char *dst)
+{
+	char tmp[strlen(dst) + 5], buf[4096];
+	int in, out;
+	ssize_t n;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", dst);
+	in = open(src, O_RDONLY);
+	if (in < 0)
+		return -1;
+	out = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+	if (out < 0) {
+		close(in);
+		return -1;
+	}
+	while ((n = read(in, buf, sizeof(buf))) > 0)
+		if (write(out, buf, n) != n) {
+			n = -1;
+			break;
+		}
+	close(in);
+	close(out);
+
+	return n < 0 ? -1 : rename(tmp, dst);
+}
+
+/* It counts the occurrences of a string in the output read so far */
+static unsigned int reload_count(const char *str)
+{
+	unsigned int n = 0;
+	const char *p;
+
+	for (p = reload_out; (p = strstr(p, str)); p += strlen(str))
+		n++;
+
+	return n;
+}
+
+/*
+ * It reads the mamma-run output until it contains n times the given
+ * string, until the end when str is NULL
+ */
+static int reload_wait(int fd, const char *str, unsigned int n)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	ssize_t len;
+
+	while (!str || reload_count(str) < n) {
+		if (poll(&pfd, 1, RELOAD_WAIT_MS) <= 0)
+			return -1;
+		len = read(fd, reload_out + reload_len,
+			   sizeof(reload_out) - 1 - reload_len);
+		if (len <= 0)
+			return str ? -1 : 0;
+		reload_len += len;
+		reload_out[reload_len] = '\0';
+	}
+
+	return 0;
+}
+
+
+static void test_reload(struct m_test *m_test)
+{
+	char dir[] = "/tmp/mamma-reload-XXXXXX", so[64];
+	int fds[2], wstatus;
+	pid_t pid;
+
+	m_assert_true(mkdtemp(dir) != NULL);
+	snprintf(so, sizeof(so), "%s/reloaded.so", dir);
+	m_assert_int_eq(0, reload_install("reloaded_v1.so", so));
+	m_assert_int_eq(0, pipe(fds));
+
+	pid = fork();
+	m_assert_int_ge(pid, 0);
+	if (!pid) {
+		dup2(fds[1], STDOUT_FILENO);
+		close(fds[0]);
+		close(fds[1]);
+		execl("./mamma-run", "mamma-run", "--watch", so, NULL);
+		_exit(127);
+	}
+	close(fds[1]);
+
+	m_check_int_eq(0, reload_wait(fds[0], "Watching", 1));
+	m_check_int_eq(0, reload_install("reloaded_v2.so", so));
+	m_check_int_eq(0, reload_wait(fds[0], "Total:", 2));
+	kill(pid, SIGINT);
+	m_check_int_eq(0, reload_wait(fds[0], NULL, 0));
+	waitpid(pid, &wstatus, 0);
+	close(fds[0]);
+	unlink(so);
+	rmdir(dir);
+	fputs(reload_out, stdout);
+
+	m_assert_true(WIFEXITED(wstatus));
+	m_assert_int_eq(EXIT_SUCCESS, WEXITSTATUS(wstatus));
+	m_assert_int_eq(2, reload_count("test v1"));
+	m_assert_int_eq(2, reload_count("test v2"));
+	/* The heap environment goes to the reloaded suite */
+	m_assert_int_eq(1, reload_count("set_up heap"));
+	m_assert_int_eq(1, reload_count("tear_down heap v2 env v1"));
+	/* The one in the old object is torn down by the old code */
+	m_assert_int_eq(1, reload_count("Releasing the kept environment of \"reloaded own\""));
+	m_assert_int_eq(1, reload_count("tear_down own v1 env v1"));
+	m_assert_int_eq(1, reload_count("set_up own v2"));
+	m_assert_int_eq(1, reload_count("tear_down own v2 env v2"));
+}
+static const char *test_reload_desc = "It reloads a rebuilt shared object and it runs its suites again";
+
+
+int main(int argc, char *argv[])
+{
+	struct m_test tests[] = {
+		m_test_desc(NULL, test_reload, NULL, test_reload_desc),
+	};
+	struct m_suite suite = {
+		.name = "Mamma watch and reload",
+		.flags = M_VERBOSE,
+		.tests = tests,
+		.test_count = M_ARRAY_SIZE(tests),
+	};
+
+	m_suite_run(&suite);
+
+	return suite.fail_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}
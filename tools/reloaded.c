@@ -0,0 +1,65 @@
+/**
+ * Shared object for the reload test: it is built twice, with
+ * RELOAD_VERSION 1 and 2, and mamma-run --watch replaces the first one
+ * with the second. Both suites keep their set_up environment: one on the
+ * heap, one in the shared object itself
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <mamma.h>
+
+static int reloaded_env = RELOAD_VERSION;
+
+static void reloaded_heap_set_up(struct m_suite *m_suite)
+{
+	int *env = malloc(sizeof(*env));
+
+	if (env)
+		*env = RELOAD_VERSION;
+	m_suite->private = env;
+	printf("set_up heap v%d\n", RELOAD_VERSION);
+}
+
+static void reloaded_heap_tear_down(struct m_suite *m_suite)
+{
+	int *env = m_suite->private;
+
+	printf("tear_down heap v%d env v%d\n", RELOAD_VERSION,
+	       env ? *env : 0);
+	free(env);
+}
+
+static void reloaded_own_set_up(struct m_suite *m_suite)
+{
+	m_suite->private = &reloaded_env;
+	printf("set_up own v%d\n", RELOAD_VERSION);
+}
+
+static void reloaded_own_tear_down(struct m_suite *m_suite)
+{
+	int *env = m_suite->private;
+
+	printf("tear_down own v%d env v%d\n", RELOAD_VERSION, *env);
+}
+
+static void reloaded_test(struct m_test *m_test)
+{
+	printf("test v%d\n", RELOAD_VERSION);
+}
+
+static struct m_test reloaded_heap_tests[] = {
+	m_test_desc(NULL, reloaded_test, NULL, "heap"),
+};
+static struct m_test reloaded_own_tests[] = {
+	m_test_desc(NULL, reloaded_test, NULL, "own"),
+};
+static struct m_suite reloaded_heap = m_suite("reloaded heap", M_KEEP_SET_UP,
+					      reloaded_heap_tests,
+					      reloaded_heap_set_up,
+					      reloaded_heap_tear_down);
+static struct m_suite reloaded_own = m_suite("reloaded own", M_KEEP_SET_UP,
+					     reloaded_own_tests,
+					     reloaded_own_set_up,
+					     reloaded_own_tear_down);
+
+struct m_suite *m_suites[] = {&reloaded_heap, &reloaded_own, NULL};